@@ -4,6 +4,9 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <map>
+#include <mutex>
+#include <future>
 
 //#define __CL_ENABLE_EXCEPTIONS
 #define CL_HPP_ENABLE_EXCEPTIONS
@@ -14,6 +17,7 @@
 #include<fstream>
 
 #include "utility.h"
+#include "tracer.h"
 
 #define SHADER_PATH "../shaders/"
 
@@ -45,23 +49,41 @@ public:
     ~CCLAPP();
 
     bool initDevice();
-	void loadShader(std::string filename);
-	bool buildProgram();
+	void loadShader(std::string filename); //starts building the main program in the background
+	bool buildProgram(); //waits for the main program
+
+	//Program registry: builds run on background threads, so host setup overlaps with compilation.
+	//getProgram()/getKernel() block only until that program is built.
+	void requestProgram(std::string filename, std::string options = "");
+	cl::Program getProgram(std::string filename, std::string options = "");
+	cl::Kernel getKernel(std::string filename, std::string kernelName);
+
+	//Additional queue on device, with profiling when tracing or the profiler need event timestamps
+	cl::CommandQueue createQueue();
 
     bool bVerbose;
 	bool bProfiler;
 	bool bVerify;
-    const size_t maxNDRange = 1 << 20; //1048576, determine this value?
+    size_t maxNDRange = 1 << 20; //Largest float count one buffer and one 1D launch can cover, set by initDevice()
 
 	cl::Context context;
+	cl::Device device; //the device queue runs on
     cl::CommandQueue queue;
     cl::Program program;
 
+	CTracer tracer; //disabled unless enabled before initDevice()
+
 	bool readFile(const std::string& filename, std::string &buffer);
 
 private:
 	std::vector<cl::Platform> platforms;
     std::vector<cl::Device> devices;	
+
+	std::string mainShader;
+	std::mutex programMutex;
+	std::map<std::string, std::shared_future<cl::Program>> programs; //key: filename and build options
+
+	cl::Program buildProgramFile(std::string filename, std::string options);
 };
 
 CCLAPP::CCLAPP(bool verbose, bool profiler, bool verify){
@@ -69,11 +91,13 @@ CCLAPP::CCLAPP(bool verbose, bool profiler, bool verify){
 	bProfiler = profiler;
 	bVerify = verify;
 }
-CCLAPP::~CCLAPP(){}
+CCLAPP::~CCLAPP(){
+	//Background builds reference this object
+	for(auto &entry : programs) entry.second.wait();
+	if(tracer.isEnabled()) tracer.write();
+}
 
 bool CCLAPP::initDevice(){
-	if(bVerbose) std::cout<<"NDRange: "<<maxNDRange<<std::endl;
-
     try {
 		cl::Platform::get(&platforms);
 
@@ -120,7 +144,15 @@ bool CCLAPP::initDevice(){
 			return false;
 		}
 
-        queue = cl::CommandQueue(context, devices[0]);
+		device = devices[0];
+        queue = createQueue();
+		tracer.attachDevice(device);
+
+		//One buffer is bounded by CL_DEVICE_MAX_MEM_ALLOC_SIZE, global ids by the device address width.
+		//Longer inputs go through CStreamEngine (stream.hpp) in chunks.
+		maxNDRange = device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>() / sizeof(float);
+		if(device.getInfo<CL_DEVICE_ADDRESS_BITS>() == 32 && maxNDRange > 0xFFFFFFFFull) maxNDRange = 0xFFFFFFFFull;
+		if(bVerbose) std::cout<<"NDRange: "<<maxNDRange<<std::endl;
 
 		//if(bVerbose) std::cout<<"Create command queue. "<<std::endl;
     } catch (const cl::Error &err) {
@@ -135,24 +167,63 @@ bool CCLAPP::initDevice(){
 }
 
 void CCLAPP::loadShader(std::string filename){
-	std::string shaderCodeStr;
-	std::string fullFilename = SHADER_PATH + filename;
-	readFile(fullFilename, shaderCodeStr);
-	program = cl::Program(context, shaderCodeStr);	
-	if(bVerbose) std::cout<<"Compile OpenCL program: "<<fullFilename<<std::endl;
+	mainShader = filename;
+	requestProgram(filename);
 }
 
 bool CCLAPP::buildProgram(){
+	CTraceScope traceScope(tracer, "Wait for program");
+	program = getProgram(mainShader);
+	return program() != NULL;
+}
+
+void CCLAPP::requestProgram(std::string filename, std::string options){
+	std::string key = options.empty() ? filename : filename + " " + options;
+	std::lock_guard<std::mutex> lock(programMutex);
+	if(programs.count(key)) return;
+	programs[key] = std::async(std::launch::async, &CCLAPP::buildProgramFile, this, filename, options).share();
+}
+
+cl::Program CCLAPP::getProgram(std::string filename, std::string options){
+	std::string key = options.empty() ? filename : filename + " " + options;
+	requestProgram(filename, options);
+	std::shared_future<cl::Program> future;
+	{
+		std::lock_guard<std::mutex> lock(programMutex);
+		future = programs[key];
+	}
+	return future.get();
+}
+
+cl::Kernel CCLAPP::getKernel(std::string filename, std::string kernelName){
+	return cl::Kernel(getProgram(filename), kernelName.c_str());
+}
+
+//Tracing and the profiler read device timestamps from events, which needs a profiling queue
+cl::CommandQueue CCLAPP::createQueue(){
+	cl_command_queue_properties queueProperties = (tracer.isEnabled() || bProfiler) ? CL_QUEUE_PROFILING_ENABLE : 0;
+	return cl::CommandQueue(context, device, queueProperties);
+}
+
+//Runs on a background thread: clBuildProgram is thread safe for distinct programs
+cl::Program CCLAPP::buildProgramFile(std::string filename, std::string options){
+	std::string traceName = "Build " + filename;
+	CTraceScope traceScope(tracer, traceName.c_str());
+	std::string shaderCodeStr;
+	std::string fullFilename = SHADER_PATH + filename;
+	if(!readFile(fullFilename, shaderCodeStr)) return cl::Program();
+	cl::Program newProgram(context, shaderCodeStr);
+	if(bVerbose) std::cout<<"Compile OpenCL program: "<<fullFilename<<" "<<options<<std::endl;
 	try {
-		program.build(devices);
+		newProgram.build(devices, options.c_str());
 	} catch (const cl::Error&) {
 		std::cerr
-		<< "OpenCL compilation error" << std::endl
-		<< program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(devices[0])
+		<< "OpenCL compilation error: " << fullFilename << std::endl
+		<< newProgram.getBuildInfo<CL_PROGRAM_BUILD_LOG>(devices[0])
 		<< std::endl;
-		return false;
+		return cl::Program();
 	}
-	return true;
+	return newProgram;
 }
 
 /**************
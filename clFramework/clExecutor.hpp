@@ -0,0 +1,160 @@
+#ifndef H_CLEXECUTOR
+#define H_CLEXECUTOR
+
+#include "clApp.hpp"
+#include "sgemm.hpp"
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <utility>
+
+/**************
+***
+*** Concurrent request serving on top of CCLAPP
+*** A pool of host workers, each with its own command queue (or a share of a smaller queue pool)
+*** and its own cl::Kernel instances. Kernels are never shared between threads, because setArg on
+*** one kernel from several threads is not safe; every other OpenCL call used here is thread safe.
+***
+**************/
+
+//Per-worker state handed to every job
+class CWorkerContext final{
+public:
+	CWorkerContext(CCLAPP &clApp, int index, cl::CommandQueue queue, int traceTrack)
+		: clApp(clApp), index(index), queue(queue), traceTrack(traceTrack), blas(clApp, &this->queue){}
+
+	CCLAPP &clApp;
+	const int index;
+	cl::CommandQueue queue;
+	const int traceTrack; //pass to clApp.tracer.newEvent()
+
+	//This worker's instance of a kernel, created from the shared program on first use
+	cl::Kernel& kernel(const std::string &filename, const std::string &kernelName);
+	//sgemm bound to this worker's queue, with this worker's kernels
+	CSgemm& getBlas();
+
+private:
+	std::map<std::string, cl::Kernel> kernels;
+	CSgemm blas;
+	bool bBlasInit = false;
+};
+
+class CCLExecutor final{
+public:
+	//numQueues == 0: one queue per worker
+	CCLExecutor(CCLAPP &clApp, int numWorkers, int numQueues = 0);
+	~CCLExecutor();
+
+	//Run job(CWorkerContext&) on the next free worker, the future holds its result or exception
+	template<class F>
+	auto submit(F job) -> std::future<decltype(job(std::declval<CWorkerContext&>()))>;
+
+	//Run job once on every worker, each on its own thread, and wait for all of them.
+	//Use it to warm up per-worker kernels before timing.
+	void forEachWorker(std::function<void(CWorkerContext&)> job);
+
+	int getNumWorkers() const { return (int)workers.size(); }
+
+private:
+	CCLAPP &clApp;
+	std::vector<cl::CommandQueue> queues;
+	std::vector<std::unique_ptr<CWorkerContext>> contexts;
+	std::vector<std::thread> workers;
+
+	std::mutex jobMutex;
+	std::condition_variable jobCondition;
+	std::deque<std::function<void(CWorkerContext&)>> jobs;
+	std::vector<std::deque<std::function<void(CWorkerContext&)>>> workerJobs; //[worker], taken before shared jobs
+	bool bStop = false;
+
+	void workerLoop(CWorkerContext &context);
+};
+
+cl::Kernel& CWorkerContext::kernel(const std::string &filename, const std::string &kernelName){
+	std::string key = filename + "/" + kernelName;
+	auto it = kernels.find(key);
+	if(it != kernels.end()) return it->second;
+	return kernels[key] = clApp.getKernel(filename, kernelName);
+}
+
+CSgemm& CWorkerContext::getBlas(){
+	if(!bBlasInit){
+		blas.init();
+		bBlasInit = true;
+	}
+	return blas;
+}
+
+CCLExecutor::CCLExecutor(CCLAPP &clApp, int numWorkers, int numQueues) : clApp(clApp){
+	if(numWorkers < 1) numWorkers = 1;
+	if(numQueues < 1 || numQueues > numWorkers) numQueues = numWorkers;
+
+	std::vector<int> traceTracks;
+	for(int q = 0; q < numQueues; q++){
+		queues.push_back(clApp.createQueue());
+		traceTracks.push_back(clApp.tracer.isEnabled() ? clApp.tracer.addQueueTrack("Pool queue " + std::to_string(q)) : 0);
+	}
+	workerJobs.resize(numWorkers);
+	for(int w = 0; w < numWorkers; w++)
+		contexts.emplace_back(new CWorkerContext(clApp, w, queues[w % numQueues], traceTracks[w % numQueues]));
+	for(int w = 0; w < numWorkers; w++)
+		workers.emplace_back(&CCLExecutor::workerLoop, this, std::ref(*contexts[w]));
+}
+
+//Finishes queued jobs, then joins the workers
+CCLExecutor::~CCLExecutor(){
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		bStop = true;
+	}
+	jobCondition.notify_all();
+	for(auto &worker : workers) worker.join();
+	for(auto &queue : queues) queue.finish();
+}
+
+template<class F>
+auto CCLExecutor::submit(F job) -> std::future<decltype(job(std::declval<CWorkerContext&>()))>{
+	typedef decltype(job(std::declval<CWorkerContext&>())) Result;
+	auto task = std::make_shared<std::packaged_task<Result(CWorkerContext&)>>(std::move(job));
+	std::future<Result> result = task->get_future();
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		jobs.push_back([task](CWorkerContext &context){ (*task)(context); });
+	}
+	jobCondition.notify_one();
+	return result;
+}
+
+void CCLExecutor::forEachWorker(std::function<void(CWorkerContext&)> job){
+	std::vector<std::future<void>> results;
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		for(auto &queue : workerJobs){
+			auto task = std::make_shared<std::packaged_task<void(CWorkerContext&)>>(job);
+			results.push_back(task->get_future());
+			queue.push_back([task](CWorkerContext &context){ (*task)(context); });
+		}
+	}
+	jobCondition.notify_all();
+	for(auto &result : results) result.get();
+}
+
+void CCLExecutor::workerLoop(CWorkerContext &context){
+	auto &ownJobs = workerJobs[context.index];
+	while(true){
+		std::function<void(CWorkerContext&)> job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobCondition.wait(lock, [&]{ return bStop || !ownJobs.empty() || !jobs.empty(); });
+			auto &source = !ownJobs.empty() ? ownJobs : jobs;
+			if(source.empty()) return; //stopping and drained
+			job = std::move(source.front());
+			source.pop_front();
+		}
+		job(context);
+	}
+}
+
+#endif
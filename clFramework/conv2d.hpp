@@ -0,0 +1,178 @@
+#ifndef H_CONV2D
+#define H_CONV2D
+
+#include "clApp.hpp"
+#include "sgemm.hpp"
+
+/**************
+***
+*** 2D convolution on top of shaders/conv2d.cl
+*** forward(): implicit GEMM, no im2col buffer is materialized
+*** forwardIm2col(): explicit im2col + CSgemm, kept as a baseline
+*** NCHW uses OIHW weights, NHWC uses OHWI weights. No bias.
+***
+**************/
+
+// Tile sizes, passed to the kernel as build options
+#define CONV_TSM 64
+#define CONV_TSN 128
+#define CONV_TSK 16
+#define CONV_WPTM 4
+#define CONV_WPTN 8
+
+enum Conv2dLayout
+{   Conv2dNCHW = 0,
+	Conv2dNHWC = 1
+};
+
+struct Conv2dParams{
+	Conv2dLayout layout = Conv2dNCHW;
+	int batch = 1;
+	int channels = 1;
+	int height = 1;
+	int width = 1;
+	int outChannels = 1;
+	int kernelH = 1;
+	int kernelW = 1;
+	int strideH = 1;
+	int strideW = 1;
+	int padH = 0;
+	int padW = 0;
+	int dilationH = 1;
+	int dilationW = 1;
+	int groups = 1;
+
+	int outHeight() const { return (height + 2*padH - dilationH*(kernelH - 1) - 1) / strideH + 1; }
+	int outWidth() const { return (width + 2*padW - dilationW*(kernelW - 1) - 1) / strideW + 1; }
+	size_t inputSize() const { return (size_t)batch * channels * height * width; }
+	size_t weightSize() const { return (size_t)outChannels * (channels/groups) * kernelH * kernelW; }
+	size_t outputSize() const { return (size_t)batch * outChannels * outHeight() * outWidth(); }
+	//im2col workspace of forwardIm2col(), in floats
+	size_t colSize() const { return (size_t)groups * (channels/groups) * kernelH * kernelW * batch * outHeight() * outWidth(); }
+	double flops() const { return 2.0 * outputSize() * (channels/groups) * kernelH * kernelW; }
+};
+
+class CConv2d final{
+public:
+	//queue: where the convolution is enqueued, clApp.queue when NULL
+	CConv2d(CCLAPP &clApp, cl::CommandQueue *queue = NULL) : clApp(clApp), queue(queue), blas(clApp, queue){}
+	~CConv2d(){}
+
+	void request(); //start building both layouts in the background, optional
+	bool init(); //waits for the builds and creates the kernels
+
+	bool forward(const Conv2dParams &params, const cl::Buffer &input, const cl::Buffer &weights,
+		const cl::Buffer &output, cl::Event *event = NULL);
+	bool forwardIm2col(const Conv2dParams &params, const cl::Buffer &input, const cl::Buffer &weights,
+		const cl::Buffer &output, const cl::Buffer &col);
+
+private:
+	CCLAPP &clApp;
+	cl::CommandQueue *queue;
+	CSgemm blas;
+	cl::Kernel convKernels[2]; //[layout]
+	cl::Kernel im2colKernels[2];
+
+	static std::string buildOptions(Conv2dLayout layout);
+	bool validate(const Conv2dParams &params);
+	void setConvArgs(cl::Kernel &kernel, const Conv2dParams &params);
+};
+
+std::string CConv2d::buildOptions(Conv2dLayout layout){
+	return "-DLAYOUT_NHWC=" + std::to_string((int)layout)
+		+ " -DTSM=" + std::to_string(CONV_TSM) + " -DTSN=" + std::to_string(CONV_TSN)
+		+ " -DTSK=" + std::to_string(CONV_TSK) + " -DWPTM=" + std::to_string(CONV_WPTM)
+		+ " -DWPTN=" + std::to_string(CONV_WPTN);
+}
+
+void CConv2d::request(){
+	clApp.requestProgram("conv2d.cl", buildOptions(Conv2dNCHW));
+	clApp.requestProgram("conv2d.cl", buildOptions(Conv2dNHWC));
+	blas.request();
+}
+
+bool CConv2d::init(){
+	const Conv2dLayout layouts[2] = {Conv2dNCHW, Conv2dNHWC};
+	for(auto layout : layouts){
+		cl::Program program = clApp.getProgram("conv2d.cl", buildOptions(layout));
+		if(!program()) return false;
+		convKernels[layout] = cl::Kernel(program, "conv2dImplicitGemm");
+		im2colKernels[layout] = cl::Kernel(program, "im2col");
+	}
+	return blas.init();
+}
+
+bool CConv2d::validate(const Conv2dParams &p){
+	bool valid = p.batch > 0 && p.channels > 0 && p.height > 0 && p.width > 0 && p.outChannels > 0
+		&& p.kernelH > 0 && p.kernelW > 0 && p.strideH > 0 && p.strideW > 0 && p.padH >= 0 && p.padW >= 0
+		&& p.dilationH > 0 && p.dilationW > 0 && p.groups > 0
+		&& p.channels % p.groups == 0 && p.outChannels % p.groups == 0
+		&& p.outHeight() > 0 && p.outWidth() > 0;
+	if(!valid) std::cerr<<"conv2d: invalid parameters"<<std::endl;
+	return valid;
+}
+
+void CConv2d::setConvArgs(cl::Kernel &kernel, const Conv2dParams &p){
+	const int args[] = {p.batch, p.channels, p.height, p.width, p.outChannels, p.kernelH, p.kernelW,
+		p.outHeight(), p.outWidth(), p.strideH, p.strideW, p.padH, p.padW, p.dilationH, p.dilationW, p.groups};
+	for(cl_uint i = 0; i < sizeof(args)/sizeof(args[0]); i++)
+		kernel.setArg(i, args[i]);
+}
+
+bool CConv2d::forward(const Conv2dParams &params, const cl::Buffer &input, const cl::Buffer &weights,
+	const cl::Buffer &output, cl::Event *event){
+	if(!validate(params)) return false;
+
+	cl::Kernel &kernel = convKernels[params.layout];
+	setConvArgs(kernel, params);
+	kernel.setArg(16, input);
+	kernel.setArg(17, weights);
+	kernel.setArg(18, output);
+
+	//GEMM per group: M = output channels, N = output pixels
+	const size_t M = params.outChannels / params.groups;
+	const size_t N = (size_t)params.batch * params.outHeight() * params.outWidth();
+	const size_t groupsM = (M + CONV_TSM - 1) / CONV_TSM;
+	const size_t groupsN = (N + CONV_TSN - 1) / CONV_TSN;
+	cl::NDRange local(CONV_TSM/CONV_WPTM, CONV_TSN/CONV_WPTN, 1);
+	cl::NDRange global(groupsM * (CONV_TSM/CONV_WPTM), groupsN * (CONV_TSN/CONV_WPTN), params.groups);
+	cl::CommandQueue &target = queue ? *queue : clApp.queue;
+	target.enqueueNDRangeKernel(kernel, cl::NullRange, global, local, NULL, event);
+	return true;
+}
+
+bool CConv2d::forwardIm2col(const Conv2dParams &params, const cl::Buffer &input, const cl::Buffer &weights,
+	const cl::Buffer &output, const cl::Buffer &col){
+	if(!validate(params)) return false;
+
+	const int OCg = params.outChannels / params.groups;
+	const int Kg = (params.channels / params.groups) * params.kernelH * params.kernelW;
+	const int pixels = params.outHeight() * params.outWidth();
+	const int P = params.batch * pixels;
+
+	cl::Kernel &kernel = im2colKernels[params.layout];
+	setConvArgs(kernel, params);
+	kernel.setArg(16, input);
+	kernel.setArg(17, col);
+	cl::CommandQueue &target = queue ? *queue : clApp.queue;
+	target.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(Kg, P, params.groups), cl::NullRange, NULL,
+		clApp.tracer.newEvent("im2col"));
+
+	//col[g] is column-major Kg x P: weights(OCg x Kg) times col is written straight into the output view
+	for(int g = 0; g < params.groups; g++){
+		if(params.layout == Conv2dNHWC){
+			//Output is column-major OCg x P with ld = outChannels
+			blas.sgemm(SgemmTrans, SgemmNoTrans, OCg, P, Kg,
+				1.0f, weights, g*OCg*Kg, Kg, col, g*P*Kg, Kg, 0.0f, output, g*OCg, params.outChannels);
+		}else{
+			//Output of image n is row-major OCg x pixels, col of image n is row-major pixels x Kg
+			for(int n = 0; n < params.batch; n++)
+				blas.sgemm(SgemmRowMajor, SgemmNoTrans, SgemmTrans, OCg, pixels, Kg,
+					1.0f, weights, g*OCg*Kg, Kg, col, g*P*Kg + n*pixels*Kg, Kg,
+					0.0f, output, (n*params.outChannels + g*OCg)*pixels, pixels);
+		}
+	}
+	return true;
+}
+
+#endif
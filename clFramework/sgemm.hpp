@@ -0,0 +1,141 @@
+#ifndef H_SGEMM
+#define H_SGEMM
+
+#include "clApp.hpp"
+#include <algorithm>
+
+/**************
+***
+*** BLAS-style sgemm on top of shaders/sgemm.cl
+*** C = alpha * op(A) * op(B) + beta * C, op(X) = X or X^T
+*** Operands are (buffer, element offset, leading dimension) views, so a sub-block of a larger
+*** matrix is passed as-is. Row-major data is computed as the transposed column-major problem.
+***
+**************/
+
+// Tile sizes, passed to the kernel as build options
+#define SGEMM_TSM 64
+#define SGEMM_TSN 64
+#define SGEMM_TSK 16
+#define SGEMM_WPTM 4
+#define SGEMM_WPTN 4
+
+enum SgemmLayout
+{   SgemmColMajor = 0,
+	SgemmRowMajor = 1
+};
+
+enum SgemmTranspose
+{   SgemmNoTrans = 0,
+	SgemmTrans = 1
+};
+
+class CSgemm final{
+public:
+	//queue: where sgemm() enqueues, clApp.queue when NULL. Kernels are per instance, use one instance per thread.
+	CSgemm(CCLAPP &clApp, cl::CommandQueue *queue = NULL) : clApp(clApp), queue(queue){}
+	~CSgemm(){}
+
+	void request(); //start building in the background, optional
+	bool init(); //waits for the build and creates the kernels
+
+	//Column-major (BLAS convention)
+	bool sgemm(SgemmTranspose transA, SgemmTranspose transB, int M, int N, int K,
+		float alpha, const cl::Buffer &A, int offA, int lda,
+		const cl::Buffer &B, int offB, int ldb,
+		float beta, const cl::Buffer &C, int offC, int ldc,
+		cl::Event *event = NULL);
+
+	//Explicit layout (CBLAS convention)
+	bool sgemm(SgemmLayout layout, SgemmTranspose transA, SgemmTranspose transB, int M, int N, int K,
+		float alpha, const cl::Buffer &A, int offA, int lda,
+		const cl::Buffer &B, int offB, int ldb,
+		float beta, const cl::Buffer &C, int offC, int ldc,
+		cl::Event *event = NULL);
+
+	cl::Program program;
+
+private:
+	CCLAPP &clApp;
+	cl::CommandQueue *queue;
+	cl::Kernel kernels[2][2]; //[transA][transB]
+
+	static std::string buildOptions();
+};
+
+std::string CSgemm::buildOptions(){
+	return "-DTSM=" + std::to_string(SGEMM_TSM) + " -DTSN=" + std::to_string(SGEMM_TSN)
+		+ " -DTSK=" + std::to_string(SGEMM_TSK) + " -DWPTM=" + std::to_string(SGEMM_WPTM)
+		+ " -DWPTN=" + std::to_string(SGEMM_WPTN);
+}
+
+void CSgemm::request(){
+	clApp.requestProgram("sgemm.cl", buildOptions());
+}
+
+bool CSgemm::init(){
+	program = clApp.getProgram("sgemm.cl", buildOptions());
+	if(!program()) return false;
+
+	const char *names[2][2] = {{"sgemmNN", "sgemmNT"}, {"sgemmTN", "sgemmTT"}};
+	for(int ta = 0; ta < 2; ta++)
+		for(int tb = 0; tb < 2; tb++)
+			kernels[ta][tb] = cl::Kernel(program, names[ta][tb]);
+	return true;
+}
+
+bool CSgemm::sgemm(SgemmTranspose transA, SgemmTranspose transB, int M, int N, int K,
+	float alpha, const cl::Buffer &A, int offA, int lda,
+	const cl::Buffer &B, int offB, int ldb,
+	float beta, const cl::Buffer &C, int offC, int ldc,
+	cl::Event *event){
+
+	//Argument checks follow reference BLAS: ld >= rows of the stored matrix
+	int rowsA = transA ? K : M;
+	int rowsB = transB ? N : K;
+	if(M < 0 || N < 0 || K < 0 || offA < 0 || offB < 0 || offC < 0
+		|| lda < std::max(1, rowsA) || ldb < std::max(1, rowsB) || ldc < std::max(1, M)){
+		std::cerr<<"sgemm: invalid argument (M="<<M<<" N="<<N<<" K="<<K
+			<<" lda="<<lda<<" ldb="<<ldb<<" ldc="<<ldc<<")"<<std::endl;
+		return false;
+	}
+	if(M == 0 || N == 0) return true;
+
+	cl::Kernel &kernel = kernels[transA][transB];
+	kernel.setArg(0, M);
+	kernel.setArg(1, N);
+	kernel.setArg(2, K);
+	kernel.setArg(3, alpha);
+	kernel.setArg(4, beta);
+	kernel.setArg(5, A);
+	kernel.setArg(6, offA);
+	kernel.setArg(7, lda);
+	kernel.setArg(8, B);
+	kernel.setArg(9, offB);
+	kernel.setArg(10, ldb);
+	kernel.setArg(11, C);
+	kernel.setArg(12, offC);
+	kernel.setArg(13, ldc);
+
+	const size_t groupsM = (M + SGEMM_TSM - 1) / SGEMM_TSM;
+	const size_t groupsN = (N + SGEMM_TSN - 1) / SGEMM_TSN;
+	cl::NDRange local(SGEMM_TSM/SGEMM_WPTM, SGEMM_TSN/SGEMM_WPTN);
+	cl::NDRange global(groupsM * (SGEMM_TSM/SGEMM_WPTM), groupsN * (SGEMM_TSN/SGEMM_WPTN));
+	cl::CommandQueue &target = queue ? *queue : clApp.queue;
+	target.enqueueNDRangeKernel(kernel, cl::NullRange, global, local, NULL, event);
+	return true;
+}
+
+bool CSgemm::sgemm(SgemmLayout layout, SgemmTranspose transA, SgemmTranspose transB, int M, int N, int K,
+	float alpha, const cl::Buffer &A, int offA, int lda,
+	const cl::Buffer &B, int offB, int ldb,
+	float beta, const cl::Buffer &C, int offC, int ldc,
+	cl::Event *event){
+	if(layout == SgemmColMajor)
+		return sgemm(transA, transB, M, N, K, alpha, A, offA, lda, B, offB, ldb, beta, C, offC, ldc, event);
+
+	//Row-major C = op(A) * op(B) is column-major C^T = op(B)^T * op(A)^T: swap operands, same transpose flags
+	return sgemm(transB, transA, N, M, K, alpha, B, offB, ldb, A, offA, lda, beta, C, offC, ldc, event);
+}
+
+#endif
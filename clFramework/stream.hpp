@@ -0,0 +1,178 @@
+#ifndef H_STREAM
+#define H_STREAM
+
+#include "clApp.hpp"
+#include <algorithm>
+#include <cstring>
+
+/**************
+***
+*** Streaming elementwise engine
+*** Runs a grid-stride kernel over host arrays of any length in fixed-size chunks.
+*** Upload, compute and download have a queue each, device memory is a ring of STREAM_SLOTS chunks,
+*** so chunk i uploads while chunk i-1 computes and chunk i-2 downloads.
+*** Kernel arguments: (ulong n, input 0..numInputs-1, output 0..numOutputs-1), all float, at least one of each.
+*** Transfers only overlap with compute from pinned host memory, so every slot also has chunk-sized
+*** pinned staging buffers: the caller's arrays are copied through them, and their length is bounded
+*** by host memory only.
+***
+**************/
+
+#define STREAM_SLOTS 3                            // Chunks resident on the device: upload, compute, download
+#define STREAM_MAX_CHUNK_BYTES (32 << 20)         // Per buffer, device and pinned; bigger chunks only lengthen pipeline fill and drain
+#define STREAM_MEM_FRACTION 2                     // Use at most 1/STREAM_MEM_FRACTION of the global memory
+#define STREAM_GROUPS_PER_CU 8                    // Grid-stride launch size, in work-groups per compute unit
+#define STREAM_LOCAL_SIZE 256
+
+class CStreamEngine final{
+public:
+	//chunkElements == 0: derived from the device limits
+	CStreamEngine(CCLAPP &clApp, int numInputs, int numOutputs, size_t chunkElements = 0);
+	~CStreamEngine();
+
+	//outputs[j][0..n) = kernel(inputs[..][0..n)), returns once the last chunk is back on the host
+	bool run(cl::Kernel &kernel, size_t n, const std::vector<const float*> &inputs, const std::vector<float*> &outputs);
+
+	size_t getChunkElements() const { return chunkElements; }
+
+private:
+	CCLAPP &clApp;
+	const int numInputs;
+	const int numOutputs;
+	size_t chunkElements;
+
+	cl::CommandQueue uploadQueue, computeQueue, downloadQueue;
+	int uploadTrack = 0, computeTrack = 0, downloadTrack = 0;
+
+	//Per ring slot: numInputs + numOutputs device buffers, as many mapped pinned staging buffers,
+	//and the download of the last chunk that used the slot
+	struct Slot{
+		std::vector<cl::Buffer> buffers;
+		std::vector<cl::Buffer> staging;
+		std::vector<float*> host;
+		cl::Event downloaded;
+		size_t offset = 0, count = 0; //chunk held by the slot
+	};
+	Slot slots[STREAM_SLOTS];
+
+	size_t chooseChunkElements() const;
+	cl::Event* event(const char *name, int track, cl::Event &fallback);
+};
+
+CStreamEngine::CStreamEngine(CCLAPP &clApp, int numInputs, int numOutputs, size_t chunkElements)
+	: clApp(clApp), numInputs(numInputs), numOutputs(numOutputs), chunkElements(chunkElements){
+	if(this->chunkElements == 0) this->chunkElements = chooseChunkElements();
+	this->chunkElements = std::min(this->chunkElements, (size_t)clApp.device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>() / sizeof(float));
+	size_t chunkBytes = this->chunkElements * sizeof(float);
+
+	uploadQueue = clApp.createQueue();
+	computeQueue = clApp.createQueue();
+	downloadQueue = clApp.createQueue();
+	if(clApp.tracer.isEnabled()){
+		uploadTrack = clApp.tracer.addQueueTrack("Stream upload");
+		computeTrack = clApp.tracer.addQueueTrack("Stream compute");
+		downloadTrack = clApp.tracer.addQueueTrack("Stream download");
+	}
+
+	for(auto &slot : slots){
+		for(int b = 0; b < numInputs + numOutputs; b++){
+			slot.buffers.push_back(cl::Buffer(clApp.context, b < numInputs ? CL_MEM_READ_ONLY : CL_MEM_WRITE_ONLY, chunkBytes));
+			slot.staging.push_back(cl::Buffer(clApp.context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, chunkBytes));
+			slot.host.push_back((float*)uploadQueue.enqueueMapBuffer(slot.staging.back(), CL_TRUE,
+				CL_MAP_READ | CL_MAP_WRITE, 0, chunkBytes));
+		}
+	}
+
+	if(clApp.bVerbose) std::cout<<"Stream chunk: "<<this->chunkElements<<" floats x "<<(numInputs + numOutputs)
+		<<" buffers x "<<STREAM_SLOTS<<" slots"<<std::endl;
+}
+
+CStreamEngine::~CStreamEngine(){
+	for(auto &slot : slots)
+		for(size_t b = 0; b < slot.staging.size(); b++)
+			uploadQueue.enqueueUnmapMemObject(slot.staging[b], slot.host[b]);
+	uploadQueue.finish();
+}
+
+//Largest chunk within one allocation, the memory budget and STREAM_MAX_CHUNK_BYTES
+size_t CStreamEngine::chooseChunkElements() const{
+	size_t maxAlloc = clApp.device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+	size_t budget = clApp.device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>() / STREAM_MEM_FRACTION;
+	size_t bytes = std::min({maxAlloc, budget / (STREAM_SLOTS * (numInputs + numOutputs)), (size_t)STREAM_MAX_CHUNK_BYTES});
+	size_t elements = bytes / sizeof(float);
+	elements -= elements % STREAM_LOCAL_SIZE;
+	return std::max(elements, (size_t)STREAM_LOCAL_SIZE);
+}
+
+cl::Event* CStreamEngine::event(const char *name, int track, cl::Event &fallback){
+	cl::Event *traced = clApp.tracer.newEvent(name, track);
+	return traced ? traced : &fallback;
+}
+
+bool CStreamEngine::run(cl::Kernel &kernel, size_t n, const std::vector<const float*> &inputs, const std::vector<float*> &outputs){
+	if(numInputs < 1 || numOutputs < 1 || (int)inputs.size() != numInputs || (int)outputs.size() != numOutputs){
+		std::cerr<<"stream: expected "<<numInputs<<" input(s) and "<<numOutputs<<" output(s)"<<std::endl;
+		return false;
+	}
+
+	//Grid-stride launch: enough work-groups to fill the device, independent of the chunk length
+	size_t local = std::min((size_t)STREAM_LOCAL_SIZE, kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(clApp.device));
+	size_t groups = (size_t)clApp.device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>() * STREAM_GROUPS_PER_CU;
+
+	//Copies a downloaded chunk from the slot's staging buffers to the caller's outputs
+	auto drain = [&](Slot &slot){
+		if(slot.count == 0) return;
+		slot.downloaded.wait();
+		CTraceScope traceScope(clApp.tracer, "Unstage outputs");
+		for(int b = 0; b < numOutputs; b++)
+			memcpy(outputs[b] + slot.offset, slot.host[numInputs + b], slot.count * sizeof(float));
+		slot.count = 0;
+	};
+
+	size_t numChunks = (n + chunkElements - 1) / chunkElements;
+	for(size_t i = 0; i < numChunks; i++){
+		//The slot is free once chunk i-STREAM_SLOTS is back on the host: its download waited for its
+		//compute, which waited for its upload. Meanwhile chunks i-2 and i-1 are in flight.
+		Slot &slot = slots[i % STREAM_SLOTS];
+		drain(slot);
+		slot.offset = i * chunkElements;
+		slot.count = std::min(chunkElements, n - slot.offset);
+		size_t bytes = slot.count * sizeof(float);
+
+		{
+			CTraceScope traceScope(clApp.tracer, "Stage inputs");
+			for(int b = 0; b < numInputs; b++)
+				memcpy(slot.host[b], inputs[b] + slot.offset, bytes);
+		}
+
+		//The queues are in order, so the last write/read of a chunk stands for all of them
+		cl::Event uploaded, *uploadEvent = event("Upload", uploadTrack, uploaded);
+		for(int b = 0; b < numInputs; b++)
+			uploadQueue.enqueueWriteBuffer(slot.buffers[b], CL_FALSE, 0, bytes, slot.host[b],
+				NULL, b == numInputs - 1 ? uploadEvent : NULL);
+		uploadQueue.flush();
+
+		std::vector<cl::Event> waitInputs(1, *uploadEvent);
+		kernel.setArg(0, static_cast<cl_ulong>(slot.count));
+		for(int b = 0; b < numInputs + numOutputs; b++)
+			kernel.setArg(b + 1, slot.buffers[b]);
+		size_t global = std::min(groups, (slot.count + local - 1) / local) * local;
+		cl::Event computed, *computeEvent = event("Compute", computeTrack, computed);
+		computeQueue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local, &waitInputs, computeEvent);
+		computeQueue.flush();
+
+		std::vector<cl::Event> waitOutputs(1, *computeEvent);
+		cl::Event downloaded, *downloadEvent = event("Download", downloadTrack, downloaded);
+		for(int b = 0; b < numOutputs; b++)
+			downloadQueue.enqueueReadBuffer(slot.buffers[numInputs + b], CL_FALSE, 0, bytes, slot.host[numInputs + b],
+				&waitOutputs, b == numOutputs - 1 ? downloadEvent : NULL);
+		downloadQueue.flush();
+		slot.downloaded = *downloadEvent;
+	}
+
+	for(size_t i = numChunks; i < numChunks + STREAM_SLOTS; i++)
+		drain(slots[i % STREAM_SLOTS]);
+	return true;
+}
+
+#endif
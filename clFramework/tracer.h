@@ -0,0 +1,249 @@
+#ifndef H_TRACER
+#define H_TRACER
+
+#include <CL/opencl.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+
+/**************
+***
+*** Chrome trace / Perfetto timeline of host spans and device commands.
+*** Enable with tracer.enable("file.json") or the OPENCLLAB_TRACE environment variable,
+*** then open the file in chrome://tracing or https://ui.perfetto.dev
+***
+**************/
+
+#define TRACE_ENV "OPENCLLAB_TRACE"
+
+class CTracer final{
+public:
+	CTracer();
+	~CTracer(){}
+
+	void enable(const std::string &filename);
+	bool isEnabled() const { return bEnabled; }
+
+	//Device side: called once the device is selected, adds the default queue track(0)
+	void attachDevice(const cl::Device &device);
+	int addQueueTrack(const std::string &name);
+
+	//Pass the returned pointer as the event argument of an enqueue call. Returns NULL when disabled.
+	cl::Event* newEvent(const char *name, int track = 0);
+
+	//Host side: beginSpan() ... endSpan(), or CTraceScope for a whole block
+	double now() const;
+	double beginSpan() const { return bEnabled ? now() : 0; }
+	void endSpan(const char *name, double beginUs, const char *category = "host");
+
+	bool write();
+
+private:
+	struct HostSpan{
+		std::string name;
+		std::string category;
+		double beginUs;
+		double endUs;
+		int tid;
+	};
+	struct DeviceRecord{
+		cl::Event event;
+		std::string name;
+		int track;
+		double enqueueUs; //host time when the event was requested, fallback anchor
+	};
+	struct SyncPoint{
+		cl_ulong deviceNs;
+		double hostUs;
+	};
+
+	bool bEnabled = false;
+	std::string filename;
+	std::chrono::steady_clock::time_point startTime;
+
+	std::mutex mtx;
+	std::vector<HostSpan> hostSpans;
+	std::deque<DeviceRecord> deviceRecords; //deque keeps event addresses stable
+	std::vector<std::string> tracks;
+	std::map<std::thread::id, int> threadIds;
+
+	cl::Device device;
+	bool bTimerSupported = false;
+	SyncPoint sync0, sync1;
+
+	bool syncTimer(SyncPoint &point);
+	double deviceToHostUs(cl_ulong deviceNs, const DeviceRecord &record, cl_ulong queuedNs) const;
+	int threadId();
+	static std::string escape(const std::string &str);
+};
+
+//RAII host span. Costs one branch when tracing is disabled.
+class CTraceScope final{
+public:
+	CTraceScope(CTracer &tracer, const char *name, const char *category = "host")
+		: tracer(tracer), name(name), category(category){
+		beginUs = tracer.beginSpan();
+	}
+	~CTraceScope(){
+		tracer.endSpan(name, beginUs, category);
+	}
+private:
+	CTracer &tracer;
+	const char *name;
+	const char *category;
+	double beginUs = 0;
+};
+
+CTracer::CTracer(){
+	const char *env = std::getenv(TRACE_ENV);
+	if(env && env[0]) enable(env);
+}
+
+void CTracer::enable(const std::string &filename){
+	this->filename = filename;
+	startTime = std::chrono::steady_clock::now();
+	bEnabled = true;
+}
+
+double CTracer::now() const{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void CTracer::attachDevice(const cl::Device &device){
+	if(!bEnabled) return;
+	this->device = device;
+	bTimerSupported = syncTimer(sync0);
+	if(bTimerSupported) sync1 = sync0;
+	std::lock_guard<std::mutex> lock(mtx);
+	if(tracks.empty()) tracks.push_back("Queue 0");
+}
+
+int CTracer::addQueueTrack(const std::string &name){
+	std::lock_guard<std::mutex> lock(mtx);
+	tracks.push_back(name);
+	return (int)tracks.size() - 1;
+}
+
+cl::Event* CTracer::newEvent(const char *name, int track){
+	if(!bEnabled) return NULL;
+	double enqueueUs = now();
+	std::lock_guard<std::mutex> lock(mtx);
+	deviceRecords.push_back({cl::Event(), name, track, enqueueUs});
+	return &deviceRecords.back().event;
+}
+
+void CTracer::endSpan(const char *name, double beginUs, const char *category){
+	if(!bEnabled) return;
+	double endUs = now();
+	std::lock_guard<std::mutex> lock(mtx);
+	hostSpans.push_back({name, category, beginUs, endUs, threadId()});
+}
+
+int CTracer::threadId(){
+	auto id = std::this_thread::get_id();
+	auto it = threadIds.find(id);
+	if(it != threadIds.end()) return it->second;
+	int tid = (int)threadIds.size();
+	threadIds[id] = tid;
+	return tid;
+}
+
+//Sample the device timer with clGetDeviceAndHostTimer (OpenCL 2.1+), bracketed by our host clock
+bool CTracer::syncTimer(SyncPoint &point){
+	try {
+		double before = now();
+		auto timers = device.getDeviceAndHostTimer();
+		double after = now();
+		point.deviceNs = timers.first;
+		point.hostUs = (before + after) * 0.5;
+		return true;
+	} catch (const cl::Error &) {
+		return false;
+	}
+}
+
+double CTracer::deviceToHostUs(cl_ulong deviceNs, const DeviceRecord &record, cl_ulong queuedNs) const{
+	if(!bTimerSupported) //Anchor CL_PROFILING_COMMAND_QUEUED at the host enqueue time
+		return record.enqueueUs + ((double)deviceNs - (double)queuedNs) * 1e-3;
+
+	//Linear map between the two sync points, corrects for clock drift over long runs
+	double scale = 1e-3;
+	if(sync1.deviceNs > sync0.deviceNs)
+		scale = (sync1.hostUs - sync0.hostUs) / (double)(sync1.deviceNs - sync0.deviceNs);
+	return sync0.hostUs + ((double)deviceNs - (double)sync0.deviceNs) * scale;
+}
+
+std::string CTracer::escape(const std::string &str){
+	std::string out;
+	for(char c : str){
+		if(c == '"' || c == '\\') out += '\\';
+		out += c;
+	}
+	return out;
+}
+
+bool CTracer::write(){
+	if(!bEnabled) return false;
+	if(bTimerSupported) syncTimer(sync1);
+
+	std::lock_guard<std::mutex> lock(mtx);
+	std::ofstream file(filename);
+	if (!file.is_open()) {
+		std::cout<<"failed to open file: "<<filename<<std::endl;
+		return false;
+	}
+
+	//pid 0: host threads; pid 1: device, one tid per queue
+	std::ostringstream out;
+	out<<std::fixed<<std::setprecision(3);
+	out<<"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out<<"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"Host\"}}";
+	for(auto &thread : threadIds)
+		out<<",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":"<<thread.second
+			<<",\"args\":{\"name\":\"Thread "<<thread.second<<"\"}}";
+	std::string deviceName = device() ? device.getInfo<CL_DEVICE_NAME>() : "Device";
+	out<<",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\""<<escape(deviceName)<<"\"}}";
+	for(size_t i = 0; i < tracks.size(); i++)
+		out<<",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"<<i
+			<<",\"args\":{\"name\":\""<<escape(tracks[i])<<"\"}}";
+
+	for(auto &span : hostSpans)
+		out<<",\n{\"name\":\""<<escape(span.name)<<"\",\"cat\":\""<<escape(span.category)
+			<<"\",\"ph\":\"X\",\"pid\":0,\"tid\":"<<span.tid
+			<<",\"ts\":"<<span.beginUs<<",\"dur\":"<<span.endUs - span.beginUs<<"}";
+
+	size_t skipped = 0;
+	for(auto &record : deviceRecords){
+		if(!record.event()) continue; //enqueue failed or was never issued
+		try {
+			record.event.wait();
+			cl_ulong queued = record.event.getProfilingInfo<CL_PROFILING_COMMAND_QUEUED>();
+			cl_ulong start = record.event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+			cl_ulong end = record.event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+			double beginUs = deviceToHostUs(start, record, queued);
+			out<<",\n{\"name\":\""<<escape(record.name)<<"\",\"cat\":\"device\",\"ph\":\"X\",\"pid\":1,\"tid\":"<<record.track
+				<<",\"ts\":"<<beginUs<<",\"dur\":"<<(end - start) * 1e-3
+				<<",\"args\":{\"queued_to_start_us\":"<<(start - queued) * 1e-3<<"}}";
+		} catch (const cl::Error &) {
+			skipped++; //queue created without CL_QUEUE_PROFILING_ENABLE
+		}
+	}
+	out<<"\n]}\n";
+
+	file<<out.str();
+	file.close();
+	std::cout<<"Trace written: "<<filename<<std::endl;
+	if(skipped) std::cout<<"Trace: "<<skipped<<" device event(s) without profiling info skipped"<<std::endl;
+	return true;
+}
+
+#endif
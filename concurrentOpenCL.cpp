@@ -0,0 +1,195 @@
+#include "clFramework/clExecutor.hpp"
+#include <iomanip>
+#include <algorithm>
+
+//Throughput/latency of independent GEMM/GEMV/add requests from concurrent clients:
+//one shared queue behind a mutex (baseline) against the CCLExecutor worker/queue pool.
+
+#define CLIENTS 8                    // Concurrent client threads, each issues requests back to back
+#define REQUESTS_PER_CLIENT 32
+#define WORKERS 4                    // Host workers in the pool
+#define QUEUES 0                     // Command queues in the pool, 0: one per worker
+#define GEMM_DIM 512
+#define GEMV_DIM 2048
+#define ADD_SIZE (1 << 20)
+
+enum JobType
+{   JOB_GEMM = 0,
+	JOB_GEMV = 1,
+	JOB_ADD = 2
+};
+const char *jobNames[] = {"sgemm", "matrixVectorMul", "vectorAdd"};
+
+//Host buffers of one client, reused by all of its requests
+struct ClientData{
+	std::vector<float> a, b, c;
+};
+
+//One request: upload, compute and download on the worker's queue, with per-request device buffers
+void RunJob(CWorkerContext &context, JobType type, ClientData &data){
+	CCLAPP &clApp = context.clApp;
+	cl::CommandQueue &queue = context.queue;
+
+	size_t sizeA = 0, sizeB = 0, sizeC = 0;
+	switch(type){
+	case JOB_GEMM:
+		sizeA = sizeB = sizeC = GEMM_DIM*GEMM_DIM;
+		break;
+	case JOB_GEMV:
+		sizeA = GEMV_DIM*GEMV_DIM;
+		sizeB = sizeC = GEMV_DIM;
+		break;
+	case JOB_ADD:
+		sizeA = sizeB = sizeC = ADD_SIZE;
+		break;
+	}
+
+	cl::Buffer A_device(clApp.context, CL_MEM_READ_ONLY, sizeA * sizeof(float));
+	cl::Buffer B_device(clApp.context, CL_MEM_READ_ONLY, sizeB * sizeof(float));
+	cl::Buffer C_device(clApp.context, CL_MEM_READ_WRITE, sizeC * sizeof(float));
+	queue.enqueueWriteBuffer(A_device, CL_FALSE, 0, sizeA * sizeof(float), data.a.data());
+	queue.enqueueWriteBuffer(B_device, CL_FALSE, 0, sizeB * sizeof(float), data.b.data());
+
+	cl::Event *event = clApp.tracer.newEvent(jobNames[type], context.traceTrack);
+	switch(type){
+	case JOB_GEMM:
+		context.getBlas().sgemm(SgemmNoTrans, SgemmNoTrans, GEMM_DIM, GEMM_DIM, GEMM_DIM,
+			1.0f, A_device, 0, GEMM_DIM, B_device, 0, GEMM_DIM, 0.0f, C_device, 0, GEMM_DIM, event);
+		break;
+	case JOB_GEMV:{
+		cl::Kernel &kernel = context.kernel("matrixVectorMul.cl", "matrixVectorMul");
+		kernel.setArg(0, GEMV_DIM);
+		kernel.setArg(1, GEMV_DIM);
+		kernel.setArg(2, A_device);
+		kernel.setArg(3, B_device);
+		kernel.setArg(4, C_device);
+		queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(GEMV_DIM), cl::NullRange, NULL, event);
+		break;
+	}
+	case JOB_ADD:{
+		cl::Kernel &kernel = context.kernel("vectorAdd.cl", "vectorAdd");
+		kernel.setArg(0, static_cast<cl_ulong>(ADD_SIZE));
+		kernel.setArg(1, A_device);
+		kernel.setArg(2, B_device);
+		kernel.setArg(3, C_device);
+		queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(ADD_SIZE), cl::NullRange, NULL, event);
+		break;
+	}
+	}
+
+	queue.enqueueReadBuffer(C_device, CL_TRUE, 0, sizeC * sizeof(float), data.c.data());
+}
+
+//Warms up, then runs CLIENTS threads against serve(), prints throughput and latency percentiles
+void RunScenario(std::string name, std::vector<ClientData> &clients, std::function<void()> warmUp,
+	std::function<void(JobType, ClientData&)> serve){
+	//Program builds, kernel creation and first launches stay out of the measurement
+	warmUp();
+
+	std::vector<std::vector<double>> latencies(CLIENTS);
+	std::vector<std::thread> threads;
+	auto start = std::chrono::high_resolution_clock::now();
+	for(int c = 0; c < CLIENTS; c++){
+		threads.emplace_back([&, c]{
+			for(int r = 0; r < REQUESTS_PER_CLIENT; r++){
+				auto requestStart = std::chrono::high_resolution_clock::now();
+				serve((JobType)((c + r) % 3), clients[c]);
+				auto requestEnd = std::chrono::high_resolution_clock::now();
+				latencies[c].push_back(std::chrono::duration<double, std::milli>(requestEnd - requestStart).count());
+			}
+		});
+	}
+	for(auto &thread : threads) thread.join();
+	auto end = std::chrono::high_resolution_clock::now();
+	double seconds = std::chrono::duration<double>(end - start).count();
+
+	std::vector<double> all;
+	for(auto &client : latencies) all.insert(all.end(), client.begin(), client.end());
+	std::sort(all.begin(), all.end());
+	auto percentile = [&all](double p){ return all[std::min(all.size() - 1, (size_t)(p * all.size()))]; };
+
+	std::cout<<std::left<<std::setw(32)<<name<<std::right<<std::fixed<<std::setprecision(1)
+		<<std::setw(10)<<all.size() / seconds
+		<<std::setw(10)<<percentile(0.50)
+		<<std::setw(10)<<percentile(0.95)
+		<<std::setw(10)<<percentile(0.99)
+		<<std::setw(10)<<all.back()<<std::endl;
+}
+
+int main() {
+	CTimer timer;
+	timer.initialize();
+
+	srand(time(NULL));
+
+	CCLAPP clApp(false, true, true);//verbose, profiler, verify
+	clApp.initDevice();
+	clApp.requestProgram("matrixVectorMul.cl");
+	clApp.requestProgram("vectorAdd.cl");
+	CSgemm(clApp).request();
+
+	//Allocate host buffers for every client, and fill with random numbers
+	std::vector<ClientData> clients(CLIENTS);
+	{
+		CTraceScope traceScope(clApp.tracer, "Generate data");
+		size_t sizeA = std::max({GEMM_DIM*GEMM_DIM, GEMV_DIM*GEMV_DIM, ADD_SIZE});
+		size_t sizeBC = std::max({GEMM_DIM*GEMM_DIM, GEMV_DIM, ADD_SIZE});
+		for(auto &client : clients){
+			client.a.resize(sizeA);
+			client.b.resize(sizeBC);
+			client.c.resize(sizeBC);
+			for(auto &x : client.a) x = (float)rand() / (float)RAND_MAX;
+			for(auto &x : client.b) x = (float)rand() / (float)RAND_MAX;
+		}
+	}
+
+	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Allocate host buffer done");
+
+	std::cout<<CLIENTS<<" clients x "<<REQUESTS_PER_CLIENT<<" requests (sgemm "<<GEMM_DIM<<", matrixVectorMul "<<GEMV_DIM
+		<<", vectorAdd "<<ADD_SIZE<<")"<<std::endl;
+	std::cout<<std::left<<std::setw(32)<<"Mode"<<std::right<<std::setw(10)<<"req/s"<<std::setw(10)<<"p50 ms"
+		<<std::setw(10)<<"p95 ms"<<std::setw(10)<<"p99 ms"<<std::setw(10)<<"max ms"<<std::endl;
+
+	//Baseline: one queue and one set of kernels, every request serialized behind a mutex
+	{
+		CWorkerContext shared(clApp, 0, clApp.queue, 0);
+		std::mutex serveMutex;
+		auto warmUp = [&]{
+			for(int type = 0; type < 3; type++) RunJob(shared, (JobType)type, clients[0]);
+		};
+		RunScenario("single queue + mutex", clients, warmUp, [&](JobType type, ClientData &data){
+			std::lock_guard<std::mutex> lock(serveMutex);
+			RunJob(shared, type, data);
+		});
+	}
+
+	//Pool: requests run concurrently on the workers' queues
+	{
+		CCLExecutor executor(clApp, WORKERS, QUEUES);
+		std::string name = "pool " + std::to_string(WORKERS) + " workers";
+		//Every worker creates its own kernels, so each one runs every job type once
+		auto warmUp = [&]{
+			executor.forEachWorker([&](CWorkerContext &context){
+				for(int type = 0; type < 3; type++) RunJob(context, (JobType)type, clients[context.index % CLIENTS]);
+			});
+		};
+		RunScenario(name, clients, warmUp, [&](JobType type, ClientData &data){
+			executor.submit([type, &data](CWorkerContext &context){ RunJob(context, type, data); }).get();
+		});
+
+		//Verify Correctness: one vectorAdd request through the pool
+		if(clApp.bVerify){
+			CTraceScope traceScope(clApp.tracer, "Verify");
+			ClientData &data = clients[0];
+			executor.submit([&data](CWorkerContext &context){ RunJob(context, JOB_ADD, data); }).get();
+			int count = 0;
+			for(int i = 0; i < ADD_SIZE; i++)
+				if(data.c[i] != data.a[i] + data.b[i]) count++;
+			std::cout<<"Verification done: "<<count<<"/"<<ADD_SIZE<<" number(s) failed"<<std::endl;
+		}
+	}
+
+	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Benchmark done");
+
+	return 1;
+}
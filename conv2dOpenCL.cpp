@@ -0,0 +1,153 @@
+#include "clFramework/conv2d.hpp"
+#include <iomanip>
+#include <chrono>
+
+//2D convolution: implicit GEMM against explicit im2col + sgemm, NCHW and NHWC.
+//Correctness on a small layer with groups, stride, dilation and padding; timing on a ResNet-like layer.
+
+#define BENCH_ITERATIONS 10
+
+//Direct convolution on the host, same layouts as the device: NCHW/OIHW or NHWC/OHWI
+void CPUDirectConv2d(const Conv2dParams &p, std::vector<float> &input, std::vector<float> &weights, std::vector<float> &output){
+	const int OH = p.outHeight(), OW = p.outWidth();
+	const int Cg = p.channels / p.groups, OCg = p.outChannels / p.groups;
+	const bool nhwc = p.layout == Conv2dNHWC;
+	for(int n = 0; n < p.batch; n++)
+	for(int oc = 0; oc < p.outChannels; oc++)
+	for(int oh = 0; oh < OH; oh++)
+	for(int ow = 0; ow < OW; ow++){
+		int g = oc / OCg;
+		float sum = 0;
+		for(int c = 0; c < Cg; c++)
+		for(int r = 0; r < p.kernelH; r++)
+		for(int s = 0; s < p.kernelW; s++){
+			int ih = oh*p.strideH - p.padH + r*p.dilationH;
+			int iw = ow*p.strideW - p.padW + s*p.dilationW;
+			if(ih < 0 || ih >= p.height || iw < 0 || iw >= p.width) continue;
+			int ic = g*Cg + c;
+			float x = nhwc ? input[(((size_t)n*p.height + ih)*p.width + iw)*p.channels + ic]
+				: input[(((size_t)n*p.channels + ic)*p.height + ih)*p.width + iw];
+			float w = nhwc ? weights[(((size_t)oc*p.kernelH + r)*p.kernelW + s)*Cg + c]
+				: weights[(((size_t)oc*Cg + c)*p.kernelH + r)*p.kernelW + s];
+			sum += x * w;
+		}
+		if(nhwc) output[(((size_t)n*OH + oh)*OW + ow)*p.outChannels + oc] = sum;
+		else output[(((size_t)n*p.outChannels + oc)*OH + oh)*OW + ow] = sum;
+	}
+}
+
+//Runs one layer through both device paths, verifies against the host and/or reports the timings
+void RunLayer(CCLAPP &clApp, CConv2d &conv, const Conv2dParams &params, bool bVerify, bool bBenchmark){
+	const char *layoutName = params.layout == Conv2dNHWC ? "NHWC" : "NCHW";
+
+	std::vector<float> input_host(params.inputSize());
+	std::vector<float> weights_host(params.weightSize());
+	std::vector<float> output_host(params.outputSize());
+	{
+		CTraceScope traceScope(clApp.tracer, "Generate data");
+		for(auto &x : input_host) x = (float)rand() / (float)RAND_MAX;
+		for(auto &x : weights_host) x = (float)rand() / (float)RAND_MAX - 0.5f;
+	}
+
+	cl::Buffer input_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+		input_host.size() * sizeof(float), input_host.data());
+	cl::Buffer weights_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+		weights_host.size() * sizeof(float), weights_host.data());
+	cl::Buffer output_device(clApp.context, CL_MEM_READ_WRITE, output_host.size() * sizeof(float));
+	cl::Buffer col_device(clApp.context, CL_MEM_READ_WRITE, params.colSize() * sizeof(float));
+
+	std::vector<float> reference;
+	if(bVerify){
+		CTraceScope traceScope(clApp.tracer, "CPU conv2d");
+		reference.resize(output_host.size());
+		CPUDirectConv2d(params, input_host, weights_host, reference);
+	}
+
+	for(int path = 0; path < 2; path++){
+		const char *pathName = path == 0 ? "implicit GEMM" : "im2col + sgemm";
+		auto run = [&]{
+			if(path == 0) conv.forward(params, input_device, weights_device, output_device, clApp.tracer.newEvent("conv2dImplicitGemm"));
+			else conv.forwardIm2col(params, input_device, weights_device, output_device, col_device);
+		};
+
+		if(bVerify){
+			CTraceScope traceScope(clApp.tracer, "Verify");
+			clApp.queue.enqueueFillBuffer(output_device, 0.0f, 0, output_host.size() * sizeof(float));
+			run();
+			clApp.queue.enqueueReadBuffer(output_device, CL_TRUE, 0, output_host.size() * sizeof(float), output_host.data());
+			float threshold = 0.0001f * params.channels / params.groups * params.kernelH * params.kernelW;
+			int count = 0;
+			for(size_t i = 0; i < output_host.size(); i++){
+				float diff = std::abs(reference[i] - output_host[i]);
+				if(diff > threshold){
+					if(count < 5)
+						std::cout<<"i="<<i<<std::setprecision(10)<<", Host: "<<reference[i]<<", Device: "<<output_host[i]<<", Diff: "<<diff<<std::endl;
+					count++;
+				}
+			}
+			std::cout<<"Verification "<<layoutName<<" "<<pathName<<": "<<count<<"/"<<output_host.size()<<" number(s) failed"<<std::endl;
+		}
+
+		if(bBenchmark){
+			run(); //warm up
+			clApp.queue.finish();
+			auto start = std::chrono::high_resolution_clock::now();
+			for(int i = 0; i < BENCH_ITERATIONS; i++) run();
+			clApp.queue.finish();
+			auto end = std::chrono::high_resolution_clock::now();
+			double ms = std::chrono::duration<double, std::milli>(end - start).count() / BENCH_ITERATIONS;
+			std::cout<<std::left<<std::setw(6)<<layoutName<<std::setw(18)<<pathName<<std::right<<std::fixed<<std::setprecision(3)
+				<<std::setw(10)<<ms<<" ms"<<std::setprecision(1)<<std::setw(10)<<params.flops() / ms * 1e-6<<" GFLOP/s";
+			if(path == 1) std::cout<<" (col workspace "<<params.colSize() * sizeof(float) / (1024*1024)<<" MB)";
+			std::cout<<std::defaultfloat<<std::endl;
+		}
+	}
+}
+
+int main() {
+	CTimer timer;
+	timer.initialize();
+
+	srand(time(NULL));
+
+	CCLAPP clApp(false, true, true);//verbose, profiler, verify
+	clApp.initDevice();
+	CConv2d conv(clApp);
+	conv.request(); //builds both layouts and sgemm in the background
+
+	//Small layer that exercises every parameter, verified against the host
+	Conv2dParams small;
+	small.batch = 2; small.channels = 8; small.height = 13; small.width = 11;
+	small.outChannels = 12; small.kernelH = 3; small.kernelW = 3;
+	small.strideH = 2; small.strideW = 2; small.padH = 2; small.padW = 2;
+	small.dilationH = 2; small.dilationW = 2; small.groups = 2;
+
+	//ResNet-like 3x3 layer for timing
+	Conv2dParams large;
+	large.batch = 8; large.channels = 64; large.height = 56; large.width = 56;
+	large.outChannels = 64; large.kernelH = 3; large.kernelW = 3;
+	large.padH = 1; large.padW = 1;
+
+	if(!conv.init()) return 0;
+	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Build program done");
+
+	const Conv2dLayout layouts[2] = {Conv2dNCHW, Conv2dNHWC};
+	if(clApp.bVerify){
+		for(auto layout : layouts){
+			small.layout = layout;
+			RunLayer(clApp, conv, small, true, false);
+		}
+		if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Verification done");
+	}
+
+	std::cout<<"Layer N="<<large.batch<<" C="<<large.channels<<" "<<large.height<<"x"<<large.width<<" OC="<<large.outChannels
+		<<" "<<large.kernelH<<"x"<<large.kernelW<<", "<<large.flops() * 1e-9<<" GFLOP"<<std::endl;
+	for(auto layout : layouts){
+		large.layout = layout;
+		RunLayer(clApp, conv, large, false, true);
+	}
+
+	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Benchmark done");
+
+	return 1;
+}
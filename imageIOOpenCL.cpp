@@ -9,17 +9,11 @@ int main() {
 
 	CCLAPP clApp(true, true, false);//verbose, profiler, verify
 	clApp.initDevice();
-	clApp.loadShader("imageIO.cl");
-	clApp.buildProgram();
-
-	//Step 1: Create kernel program from shader function
-	cl::Kernel program_kernel;
-	std::string kernelName = "read_write_image";
-	program_kernel = cl::Kernel(clApp.program, kernelName.c_str());
+	clApp.loadShader("imageIO.cl"); //builds in the background while host data is generated and uploaded
 	
 	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Initializazion done");
 
-	//Step 2: Allocate host buffers, and fill with random numbers
+	//Step 1: Allocate host buffers, and fill with random numbers
 	if(clApp.bVerbose) std::cout<<"imageA_host: "<<std::endl;
 	std::vector<float> imageA_host(256, 0.0);
 	for(int i = 0; i < 256; i++){
@@ -32,16 +26,24 @@ int main() {
 
 	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Allocate host buffer done");
 
-	//Step 3: host >> device (Allocate device buffers and transfer data) 
+	//Step 2: host >> device (Allocate device buffers and transfer data) 
 	cl::ImageFormat grayscale(CL_R, CL_FLOAT);
 	cl::Image2D Input_Image(clApp.context, CL_MEM_READ_ONLY, grayscale, 16, 16);
 	cl::Image2D Output_Image(clApp.context, CL_MEM_WRITE_ONLY, grayscale, 16, 16);
 	std::array<cl::size_type, 3> origin {0,0,0};
 	std::array<cl::size_type, 3> region {16,16,1};
-	clApp.queue.enqueueWriteImage(Input_Image, CL_TRUE, origin, region, 0, 0, &imageA_host[0]);
+	clApp.queue.enqueueWriteImage(Input_Image, CL_TRUE, origin, region, 0, 0, &imageA_host[0], NULL, clApp.tracer.newEvent("Write image"));
 
 	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Host >> Device");
 
+	//Step 3: Create kernel program from shader function (blocks until the build is done)
+	clApp.buildProgram();
+	cl::Kernel program_kernel;
+	std::string kernelName = "read_write_image";
+	program_kernel = cl::Kernel(clApp.program, kernelName.c_str());
+
+	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Build program done");
+
 	//Step 4: Set kernel parameters.
 	program_kernel.setArg(0, Input_Image);
 	program_kernel.setArg(1, Output_Image);
@@ -49,13 +51,13 @@ int main() {
 	//if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Set kernel parameters");
 	
 	//Step 5: Launch kernel on the compute device.
-	clApp.queue.enqueueNDRangeKernel(program_kernel, cl::NullRange, cl::NDRange(16,16), cl::NullRange, NULL);
+	clApp.queue.enqueueNDRangeKernel(program_kernel, cl::NullRange, cl::NDRange(16,16), cl::NullRange, NULL, clApp.tracer.newEvent(kernelName.c_str()));
 	clApp.queue.finish();//block host until device finishes
 
 	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Kernel run done");
 
 	//Step 6: device >> host
-	clApp.queue.enqueueReadImage(Output_Image, CL_TRUE, origin, region, 0, 0, &imageB_host[0]);
+	clApp.queue.enqueueReadImage(Output_Image, CL_TRUE, origin, region, 0, 0, &imageB_host[0], NULL, clApp.tracer.newEvent("Read image"));
 
 	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Device >> Host");
 
@@ -1,4 +1,5 @@
 #include "clFramework/clApp.hpp"
+#include "clFramework/stream.hpp"
 
 //#define DIM 32768 //mxk squares + kxn squares, use power of 2(32768 = 1<<15)
 #define DIM 16384
@@ -11,15 +12,11 @@ int main() {
 
 	CCLAPP clApp(false, true, true);
 	clApp.initDevice();
-	clApp.loadShader("matrixAdd.cl");// Compute c = a + b.
-	clApp.buildProgram();
-
-	//Step 1: Create kernel program from shader function
-	cl::Kernel program_kernel(clApp.program, "matrixAdd");
+	clApp.loadShader("matrixAdd.cl");// Compute c = a + b. Builds in the background while host data is generated and uploaded
 
 	if(clApp.bProfiler) timer.printDeltaTime("Initializazion done");
 
-	//Step 2: Allocate host buffers, and fill with random numbers
+	//Step 1: Allocate host buffers, and fill with random numbers
 	const int matrixDimM = DIM; 
 	const int matrixDimK = DIM;
 	const int matrixDimN = DIM;
@@ -27,11 +24,14 @@ int main() {
 	std::vector<float> b_host(matrixDimK*matrixDimN); 
 	std::vector<float> c_host(matrixDimM*matrixDimN); 
 
-	for (int i=0; i<matrixDimM*matrixDimK; i++) {
-		a_host[i] = (float)rand() / (float)RAND_MAX;
-	}
-	for (int i=0; i<matrixDimK*matrixDimN; i++) {
-		b_host[i] = (float)rand() / (float)RAND_MAX;
+	{
+		CTraceScope traceScope(clApp.tracer, "Generate data");
+		for (int i=0; i<matrixDimM*matrixDimK; i++) {
+			a_host[i] = (float)rand() / (float)RAND_MAX;
+		}
+		for (int i=0; i<matrixDimK*matrixDimN; i++) {
+			b_host[i] = (float)rand() / (float)RAND_MAX;
+		}
 	}
 
 	if(clApp.bVerbose) PrintMatrix("Matrix A: ", a_host, matrixDimM, matrixDimK);
@@ -39,39 +39,59 @@ int main() {
 
 	if(clApp.bProfiler) timer.printDeltaTime("Allocate host buffer done");
 
-	//Step 3: host >> device (Allocate device buffers and transfer data) 
-	cl::Buffer A_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-		a_host.size() * sizeof(float), a_host.data());
-	cl::Buffer B_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-		b_host.size() * sizeof(float), b_host.data());
-	cl::Buffer C_device(clApp.context, CL_MEM_READ_WRITE,
-		c_host.size() * sizeof(float));
-
-	if(clApp.bProfiler) timer.printDeltaTime("Host >> Device");
-
-	//Step 4: Set kernel parameters.
-	program_kernel.setArg(0, matrixDimM);
-	program_kernel.setArg(1, matrixDimN);
-	program_kernel.setArg(2, A_device);
-	program_kernel.setArg(3, B_device);
-	program_kernel.setArg(4, C_device);
+	//Matrices that don't fit on the device at once are streamed through it in chunks
+	size_t matrixBytes = (size_t)matrixDimM * matrixDimN * sizeof(float);
+	bool bStream = matrixBytes > clApp.device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>()
+		|| 3 * matrixBytes > clApp.device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
+
+	if(bStream){
+		//Step 2-6: chunked host >> device, kernel, device >> host, overlapped on three queues
+		CStreamEngine stream(clApp, 2, 1);
+		clApp.buildProgram();
+		cl::Kernel stream_kernel(clApp.program, "matrixAddStride");
+		stream.run(stream_kernel, (size_t)matrixDimM * matrixDimN, {a_host.data(), b_host.data()}, {c_host.data()});
+
+		if(clApp.bProfiler) timer.printDeltaTime("Streamed in chunks of " + std::to_string(stream.getChunkElements()));
+	}else{
+		//Step 2: host >> device (Allocate device buffers and transfer data) 
+		cl::Buffer A_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+			a_host.size() * sizeof(float), a_host.data());
+		cl::Buffer B_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+			b_host.size() * sizeof(float), b_host.data());
+		cl::Buffer C_device(clApp.context, CL_MEM_READ_WRITE,
+			c_host.size() * sizeof(float));
+
+		if(clApp.bProfiler) timer.printDeltaTime("Host >> Device");
+
+		//Step 3: Create kernel program from shader function (blocks until the build is done)
+		clApp.buildProgram();
+		cl::Kernel program_kernel(clApp.program, "matrixAdd");
+
+		//Step 4: Set kernel parameters.
+		program_kernel.setArg(0, matrixDimM);
+		program_kernel.setArg(1, matrixDimN);
+		program_kernel.setArg(2, A_device);
+		program_kernel.setArg(3, B_device);
+		program_kernel.setArg(4, C_device);
 	
-	//Step 5: Launch kernel on the compute device.
-	cl::NDRange global(matrixDimM, matrixDimN);
-	clApp.queue.enqueueNDRangeKernel(program_kernel, cl::NullRange, global, cl::NullRange);
-	clApp.queue.finish();//block host until device finishes
+		//Step 5: Launch kernel on the compute device.
+		cl::NDRange global(matrixDimM, matrixDimN);
+		clApp.queue.enqueueNDRangeKernel(program_kernel, cl::NullRange, global, cl::NullRange, NULL, clApp.tracer.newEvent("matrixAdd"));
+		clApp.queue.finish();//block host until device finishes
 
-	if(clApp.bProfiler) timer.printDeltaTime("Kernel run done");
+		if(clApp.bProfiler) timer.printDeltaTime("Kernel run done");
 
-	//Step 6: device >> host
-	clApp.queue.enqueueReadBuffer(C_device, CL_TRUE, 0, c_host.size() * sizeof(float), c_host.data());
+		//Step 6: device >> host
+		clApp.queue.enqueueReadBuffer(C_device, CL_TRUE, 0, c_host.size() * sizeof(float), c_host.data(), NULL, clApp.tracer.newEvent("Read C"));
 
-	if(clApp.bProfiler) timer.printDeltaTime("Device >> Host");
+		if(clApp.bProfiler) timer.printDeltaTime("Device >> Host");
+	}
 
 	if(clApp.bVerbose) PrintMatrix("Matrix C: ", c_host, matrixDimM, matrixDimN);
 
 	//Verify Correctness
 	if(clApp.bVerify){
+		CTraceScope traceScope(clApp.tracer, "Verify");
 		int sampleNum = 100 > matrixDimM*matrixDimN ? matrixDimM*matrixDimN : 100;
 		std::cout<<"sampleNum: "<<sampleNum<<std::endl;
 		float threshold = 0.000001f;
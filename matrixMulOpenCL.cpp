@@ -1,5 +1,7 @@
 #include "clFramework/clApp.hpp"
 #include <iomanip>
+#include <algorithm>
+#include <cfloat>
 
 //#define DIM 128
 //#define DIM 256
@@ -8,6 +10,13 @@
 //#define DIM 16384
 //#define DIM 32768
 
+// Problem size, square by default. Tall-skinny example for split-K:
+// DIM_M 256, DIM_N 256, DIM_K 1048576
+// (the absolute threshold below doesn't hold for such K, split-K is verified by VerifySplitK() instead)
+#define DIM_M DIM
+#define DIM_N DIM
+#define DIM_K DIM
+
 enum KernelModes 
 {   KERNEL1 = 0, //Naive implementation
     KERNEL2 = 1, //Tiling in the local memory
@@ -36,6 +45,32 @@ enum KernelModes
 #define WPTM 8                       // The amount of work-per-thread in dimension M
 #define WPTN 8                       // The amount of work-per-thread in dimension N
 
+// Constants for split-K (kernel 6 only)
+#define SPLITK_GROUPS_PER_CU 2       // Target number of work-groups per compute unit
+#define SPLITK_MIN_TILES 16          // Minimum TSK tiles per split, keeps the reduce pass cheap
+#define SPLITK_MAX 64                // Upper bound on splits, bounds the workspace to SPLITK_MAX*M*N floats
+#define SPLITK_VERIFY_M 256          // Tall-skinny shape of the split-K check, always run with splits > 1
+#define SPLITK_VERIFY_N 256
+#define SPLITK_VERIFY_K 16384
+#define CEIL_DIV(x,y) (((x) + (y) - 1) / (y))
+
+//Split K across work-groups when the C tiles alone can't fill the device. Returns 1 for the direct kernel.
+int ChooseSplitK(int M, int N, int K, cl_uint computeUnits){
+	int tiles = (M/TSM) * (N/TSN);
+	int targetGroups = SPLITK_GROUPS_PER_CU * (int)computeUnits;
+	if(tiles >= targetGroups) return 1;
+
+	int kTiles = K/TSK;
+	int splits = CEIL_DIV(targetGroups, tiles);
+	splits = std::min(splits, kTiles / SPLITK_MIN_TILES);
+	splits = std::min(splits, SPLITK_MAX);
+	if(splits <= 1) return 1;
+
+	//Drop empty trailing splits
+	int tilesPerSplit = CEIL_DIV(kTiles, splits);
+	return CEIL_DIV(kTiles, tilesPerSplit);
+}
+
 void CPUSingleThreadMatMul(int M, int N, int K, std::vector<float> &matrixA, std::vector<float> &matrixB, std::vector<float> &outputMatrix, int sampleNum){
     int count = 0;
 	int printDelta = sampleNum / 1;
@@ -58,6 +93,68 @@ void CPUSingleThreadMatMul(int M, int N, int K, std::vector<float> &matrixA, std
     }
 }
 
+//Runs matrixMul6SplitK + splitKReduce on a tall-skinny shape with at least 2 splits and checks it against the host.
+//The tolerance is relative and scaled by K: float sums of K terms carry up to K*FLT_EPSILON relative error,
+//a missing or doubled split is off by at least 1/splits.
+void VerifySplitK(CCLAPP &clApp){
+	const int M = SPLITK_VERIFY_M, N = SPLITK_VERIFY_N, K = SPLITK_VERIFY_K;
+	int splitK = std::max(2, ChooseSplitK(M, N, K, clApp.device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>()));
+	int tilesPerSplit = CEIL_DIV(K/TSK, splitK);
+	splitK = CEIL_DIV(K/TSK, tilesPerSplit);
+
+	std::vector<float> a_host((size_t)M*K), b_host((size_t)K*N), c_host((size_t)M*N);
+	for(auto &x : a_host) x = (float)rand() / (float)RAND_MAX;
+	for(auto &x : b_host) x = (float)rand() / (float)RAND_MAX;
+
+	cl::Buffer A_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, a_host.size() * sizeof(float), a_host.data());
+	cl::Buffer B_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, b_host.size() * sizeof(float), b_host.data());
+	cl::Buffer B_TR_device(clApp.context, CL_MEM_READ_WRITE, b_host.size() * sizeof(float));
+	cl::Buffer C_part_device(clApp.context, CL_MEM_READ_WRITE, (size_t)splitK * c_host.size() * sizeof(float));
+	cl::Buffer C_device(clApp.context, CL_MEM_READ_WRITE, c_host.size() * sizeof(float));
+
+	cl::Kernel transpose(clApp.program, "transpose");
+	transpose.setArg(0, K);
+	transpose.setArg(1, N);
+	transpose.setArg(2, B_device);
+	transpose.setArg(3, B_TR_device);
+	cl::Kernel splitKernel(clApp.program, "matrixMul6SplitK");
+	splitKernel.setArg(0, M);
+	splitKernel.setArg(1, N);
+	splitKernel.setArg(2, K);
+	splitKernel.setArg(3, tilesPerSplit);
+	splitKernel.setArg(4, A_device);
+	splitKernel.setArg(5, B_TR_device);
+	splitKernel.setArg(6, C_part_device);
+	cl::Kernel reduce(clApp.program, "splitKReduce");
+	reduce.setArg(0, M*N);
+	reduce.setArg(1, splitK);
+	reduce.setArg(2, C_part_device);
+	reduce.setArg(3, C_device);
+
+	clApp.queue.enqueueNDRangeKernel(transpose, cl::NullRange, cl::NDRange(K, N), cl::NDRange(TRANSPOSEX, TRANSPOSEY));
+	clApp.queue.enqueueNDRangeKernel(splitKernel, cl::NullRange, cl::NDRange(M/WPTM, N/WPTN, splitK), cl::NDRange(TSM/WPTM, TSN/WPTN, 1));
+	size_t reduceLocal = 256;
+	clApp.queue.enqueueNDRangeKernel(reduce, cl::NullRange, CEIL_DIV((size_t)M*N, reduceLocal) * reduceLocal, reduceLocal);
+	clApp.queue.enqueueReadBuffer(C_device, CL_TRUE, 0, c_host.size() * sizeof(float), c_host.data());
+
+	int sampleNum = M*N;
+	std::vector<float> outputMatrix(M*N);
+	CPUSingleThreadMatMul(M, N, K, a_host, b_host, outputMatrix, sampleNum);
+
+	float relativeThreshold = K * FLT_EPSILON;
+	int count = 0;
+	for(int i = 0; i < sampleNum; i++){
+		float diff = std::abs(outputMatrix[i]-c_host[i]);
+		if(diff > relativeThreshold * std::abs(outputMatrix[i])){
+			if(count < 5)
+				std::cout<<"i="<<i<<std::setprecision(10)<<", Host: "<<outputMatrix[i]<<", Device: "<<c_host[i]<<", Diff: "<<diff<<std::endl;
+			count++;
+		}
+	}
+	std::cout<<"Split-K verification ("<<M<<"x"<<N<<"x"<<K<<", "<<splitK<<" splits, relative threshold="<<relativeThreshold<<"): "
+		<<count<<"/"<<sampleNum<<" number(s) failed"<<std::endl;
+}
+
 int main() {
 	CTimer timer;
 	timer.initialize();
@@ -69,54 +166,79 @@ int main() {
 	//https://cnugteren.github.io/tutorial/pages/page2.html
 	//Column Majer: Compute c(M by N) = a(K by M) * b(N by K)
 	//Row Major Euqivalent?: c(N by M) = b(N by K) * a(K by M) 
-	clApp.loadShader("matrixMul.cl");
-	clApp.buildProgram();
+	clApp.loadShader("matrixMul.cl"); //builds in the background while host data is generated and uploaded
 
 	KernelModes kernelMode = KERNEL6;
 
-	//Step 1: Create kernel program from shader function
-	cl::Kernel program_kernel;
-	std::string kernelName = "matrixMul" + std::to_string(kernelMode+1);
-	program_kernel = cl::Kernel(clApp.program, kernelName.c_str());
+	//Split-K applies to kernel 6 when M*N has too few tiles to occupy all compute units
+	int splitK = 1;
+	if(kernelMode == KERNEL6)
+		splitK = ChooseSplitK(DIM_M, DIM_N, DIM_K, clApp.device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>());
+	int tilesPerSplit = CEIL_DIV(DIM_K/TSK, splitK);
+	if(clApp.bProfiler) std::cout<<"Split-K: "<<splitK<<" split(s), "<<tilesPerSplit<<" K tile(s) per split"<<std::endl;
 
-	cl::Kernel program_transpose;
-	if(kernelMode == KERNEL5 || kernelMode == KERNEL6)
-		program_transpose = cl::Kernel(clApp.program, "transpose");
-	
 	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Initializazion done");
 
-	//Step 2: Allocate host buffers, and fill with random numbers
-	const int matrixDimM = DIM; 
-	const int matrixDimK = DIM;
-	const int matrixDimN = DIM;
+	//Step 1: Allocate host buffers, and fill with random numbers
+	const int matrixDimM = DIM_M; 
+	const int matrixDimK = DIM_K;
+	const int matrixDimN = DIM_N;
 	std::vector<float> a_host(matrixDimM*matrixDimK); 
 	std::vector<float> b_host(matrixDimK*matrixDimN); 
 	std::vector<float> c_host(matrixDimM*matrixDimN); 
 
-	for (int i=0; i<matrixDimM*matrixDimK; i++) 
-		a_host[i] = (float)rand() / (float)RAND_MAX;
-	for (int i=0; i<matrixDimK*matrixDimN; i++) 
-		b_host[i] = (float)rand() / (float)RAND_MAX;
+	{
+		CTraceScope traceScope(clApp.tracer, "Generate data");
+		for (int i=0; i<matrixDimM*matrixDimK; i++) 
+			a_host[i] = (float)rand() / (float)RAND_MAX;
+		for (int i=0; i<matrixDimK*matrixDimN; i++) 
+			b_host[i] = (float)rand() / (float)RAND_MAX;
+	}
 
 	if(clApp.bVerbose) PrintMatrix("Matrix A: ", a_host, matrixDimM, matrixDimK);
 	if(clApp.bVerbose) PrintMatrix("Matrix B: ", b_host, matrixDimK, matrixDimN);
 
 	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Allocate host buffer done");
 
-	//Step 3: host >> device (Allocate device buffers and transfer data) 
+	//Step 2: host >> device (Allocate device buffers and transfer data) 
+	double allocBeginUs = clApp.tracer.beginSpan();
 	cl::Buffer A_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
 		a_host.size() * sizeof(float), a_host.data());
 	cl::Buffer B_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
 		b_host.size() * sizeof(float), b_host.data());
-	cl::Buffer C_device(clApp.context, CL_MEM_READ_ONLY, //Option: CL_MEM_READ_WRITE: if need copy value to erase the previous run
+	cl::Buffer C_device(clApp.context, CL_MEM_READ_WRITE, //written by the kernel, and by splitKReduce for split-K
 		c_host.size() * sizeof(float));
 
 	//Transpose B for Kernel5&6
 	cl::Buffer B_TR_device(clApp.context, CL_MEM_READ_ONLY, 
 		b_host.size() * sizeof(float));
 
+	//Partial C slices for split-K, reduced into C by a second pass
+	cl::Buffer C_part_device;
+	if(splitK > 1)
+		C_part_device = cl::Buffer(clApp.context, CL_MEM_READ_WRITE,
+			(size_t)splitK * c_host.size() * sizeof(float));
+
+	clApp.tracer.endSpan("Host >> Device", allocBeginUs);
 	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Host >> Device");
 
+	//Step 3: Create kernel program from shader function (blocks until the build is done)
+	clApp.buildProgram();
+	cl::Kernel program_kernel;
+	std::string kernelName = "matrixMul" + std::to_string(kernelMode+1);
+	if(splitK > 1) kernelName = "matrixMul6SplitK";
+	program_kernel = cl::Kernel(clApp.program, kernelName.c_str());
+
+	cl::Kernel program_reduce;
+	if(splitK > 1)
+		program_reduce = cl::Kernel(clApp.program, "splitKReduce");
+
+	cl::Kernel program_transpose;
+	if(kernelMode == KERNEL5 || kernelMode == KERNEL6)
+		program_transpose = cl::Kernel(clApp.program, "transpose");
+
+	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Build program done");
+
 	//Step 4: Set kernel parameters.
 	if(kernelMode == KERNEL5 || kernelMode == KERNEL6){
 		program_transpose.setArg(0, matrixDimK);
@@ -128,10 +250,22 @@ int main() {
 	program_kernel.setArg(0, matrixDimM);
 	program_kernel.setArg(1, matrixDimN);
     program_kernel.setArg(2, matrixDimK);
-	program_kernel.setArg(3, A_device);
-	if(kernelMode == KERNEL5 || kernelMode == KERNEL6) program_kernel.setArg(4, B_TR_device);
-	else program_kernel.setArg(4, B_device);
-	program_kernel.setArg(5, C_device);
+	if(splitK > 1){
+		program_kernel.setArg(3, tilesPerSplit);
+		program_kernel.setArg(4, A_device);
+		program_kernel.setArg(5, B_TR_device);
+		program_kernel.setArg(6, C_part_device);
+
+		program_reduce.setArg(0, matrixDimM*matrixDimN);
+		program_reduce.setArg(1, splitK);
+		program_reduce.setArg(2, C_part_device);
+		program_reduce.setArg(3, C_device);
+	}else{
+		program_kernel.setArg(3, A_device);
+		if(kernelMode == KERNEL5 || kernelMode == KERNEL6) program_kernel.setArg(4, B_TR_device);
+		else program_kernel.setArg(4, B_device);
+		program_kernel.setArg(5, C_device);
+	}
 
 	//if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Set kernel parameters");
 	
@@ -159,6 +293,10 @@ int main() {
 	case KERNEL6:
 		local = cl::NDRange(TSM/WPTM, TSN/WPTN);
     	global = cl::NDRange(matrixDimM/WPTM, matrixDimN/WPTN);
+		if(splitK > 1){
+			local = cl::NDRange(TSM/WPTM, TSN/WPTN, 1);
+			global = cl::NDRange(matrixDimM/WPTM, matrixDimN/WPTN, splitK);
+		}
 		break;
 	default:
 		break;
@@ -167,16 +305,21 @@ int main() {
 	if(kernelMode == KERNEL5 || kernelMode == KERNEL6){
 		cl::NDRange transposeLocal(TRANSPOSEX, TRANSPOSEY);
     	cl::NDRange transposeGlobal(matrixDimK, matrixDimN);
-		clApp.queue.enqueueNDRangeKernel(program_transpose, cl::NullRange, transposeGlobal, transposeLocal);
+		clApp.queue.enqueueNDRangeKernel(program_transpose, cl::NullRange, transposeGlobal, transposeLocal, NULL, clApp.tracer.newEvent("transpose"));
 	}
 
-	clApp.queue.enqueueNDRangeKernel(program_kernel, cl::NullRange, global, local);
+	clApp.queue.enqueueNDRangeKernel(program_kernel, cl::NullRange, global, local, NULL, clApp.tracer.newEvent(kernelName.c_str()));
+	if(splitK > 1){
+		size_t reduceLocal = 256;
+		size_t reduceGlobal = CEIL_DIV((size_t)matrixDimM*matrixDimN, reduceLocal) * reduceLocal;
+		clApp.queue.enqueueNDRangeKernel(program_reduce, cl::NullRange, reduceGlobal, reduceLocal, NULL, clApp.tracer.newEvent("splitKReduce"));
+	}
 	clApp.queue.finish();//block host until device finishes
 
 	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Kernel run done");
 
 	//Step 6: device >> host
-	clApp.queue.enqueueReadBuffer(C_device, CL_TRUE, 0, c_host.size() * sizeof(float), c_host.data());
+	clApp.queue.enqueueReadBuffer(C_device, CL_TRUE, 0, c_host.size() * sizeof(float), c_host.data(), NULL, clApp.tracer.newEvent("Read C"));
 
 	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Device >> Host");
 
@@ -184,6 +327,7 @@ int main() {
 
 	//Verify Correctness
 	if(clApp.bVerify){
+		CTraceScope traceScope(clApp.tracer, "Verify");
 		int sampleNum = 10000 > matrixDimM*matrixDimN ? matrixDimM*matrixDimN : 10000;
 		//int sampleNum = matrixDimM*matrixDimN;
 		float threshold = 0.00013f;
@@ -204,6 +348,10 @@ int main() {
 		}
 		if(count > 5) std::cout<<"("<<count-5<<" failed numbers not printed.)"<<std::endl;
 		std::cout<<"Verification done: "<<count<<"/"<<sampleNum<<" number(s) failed"<<std::endl;
+
+		//The shape above rarely needs split-K, check that path on its own
+		VerifySplitK(clApp);
+		if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Split-K verification done");
 	}
 
 
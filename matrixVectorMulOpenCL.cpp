@@ -33,15 +33,11 @@ int main() {
 
 	CCLAPP clApp(false, true, true);//verbose, profiler, verify
 	clApp.initDevice();
-	clApp.loadShader("matrixVectorMul.cl");//Row Major: matrixA(m by n) * vectorB(n by 1) = vectorC(m by 1)
-	clApp.buildProgram();
-
-	//Step 1: Create kernel program from shader function
-	cl::Kernel program_kernel(clApp.program, "matrixVectorMul");
+	clApp.loadShader("matrixVectorMul.cl");//Row Major: matrixA(m by n) * vectorB(n by 1) = vectorC(m by 1), builds in the background
 
 	if(clApp.bProfiler) timer.printDeltaTime("Initializazion done");
 
-	//Step 2: Allocate host buffers, and fill with random numbers
+	//Step 1: Allocate host buffers, and fill with random numbers
 	const int matrixDimM = DIM; 
 	const int matrixDimN = DIM;
 	std::vector<float> a_host(matrixDimM*matrixDimN, 1); 
@@ -49,10 +45,13 @@ int main() {
 	std::vector<float> c_host(matrixDimM); 
 
 
-	for (int i=0; i<matrixDimM*matrixDimN; i++) 
-		a_host[i] = (float)rand() / (float)RAND_MAX;
-	for (int i=0; i<matrixDimN; i++) 
-		b_host[i] = (float)rand() / (float)RAND_MAX;
+	{
+		CTraceScope traceScope(clApp.tracer, "Generate data");
+		for (int i=0; i<matrixDimM*matrixDimN; i++) 
+			a_host[i] = (float)rand() / (float)RAND_MAX;
+		for (int i=0; i<matrixDimN; i++) 
+			b_host[i] = (float)rand() / (float)RAND_MAX;
+	}
 	
 
 	if(clApp.bVerbose) PrintMatrix("Matrix A: ", a_host, matrixDimM, matrixDimN);
@@ -60,7 +59,7 @@ int main() {
 
 	if(clApp.bProfiler) timer.printDeltaTime("Allocate host buffer done");
 
-	//Step 3: host >> device (Allocate device buffers and transfer data) 
+	//Step 2: host >> device (Allocate device buffers and transfer data) 
 	cl::Buffer A_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
 		a_host.size() * sizeof(float), a_host.data());
 	cl::Buffer B_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
@@ -70,6 +69,12 @@ int main() {
 
 	if(clApp.bProfiler) timer.printDeltaTime("Host >> Device");
 
+	//Step 3: Create kernel program from shader function (blocks until the build is done)
+	clApp.buildProgram();
+	cl::Kernel program_kernel(clApp.program, "matrixVectorMul");
+
+	if(clApp.bProfiler) timer.printDeltaTime("Build program done");
+
 	//Step 4: Set kernel parameters.
 	program_kernel.setArg(0, matrixDimM);
 	program_kernel.setArg(1, matrixDimN);
@@ -79,13 +84,13 @@ int main() {
 	
 	//Step 5: Launch kernel on the compute device.
 	cl::NDRange global(matrixDimM, matrixDimN);
-	clApp.queue.enqueueNDRangeKernel(program_kernel, cl::NullRange, global, cl::NullRange);
+	clApp.queue.enqueueNDRangeKernel(program_kernel, cl::NullRange, global, cl::NullRange, NULL, clApp.tracer.newEvent("matrixVectorMul"));
 	clApp.queue.finish();//block host until device finishes
 
 	if(clApp.bProfiler) timer.printDeltaTime("Kernel run done");
 
 	//Step 6: device >> host
-	clApp.queue.enqueueReadBuffer(C_device, CL_TRUE, 0, c_host.size() * sizeof(float), c_host.data());
+	clApp.queue.enqueueReadBuffer(C_device, CL_TRUE, 0, c_host.size() * sizeof(float), c_host.data(), NULL, clApp.tracer.newEvent("Read C"));
 
 	if(clApp.bProfiler) timer.printDeltaTime("Device >> Host");
 
@@ -93,6 +98,7 @@ int main() {
 
 	//Verify Correctness
 	if(clApp.bVerify){
+		CTraceScope traceScope(clApp.tracer, "Verify");
 		int sampleNum = 100 > matrixDimM ? matrixDimM : 100;
 		float threshold = 0.0001f;
 
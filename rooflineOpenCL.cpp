@@ -0,0 +1,358 @@
+#include "clFramework/sgemm.hpp"
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+
+//Measures the device ceilings (global/local memory bandwidth, host<->device transfer, peak FMA)
+//then places every kernel in shaders/ on the roofline as a percentage of its attainable bound.
+
+#define BENCH_REPEAT 5                  // Timed runs per measurement (best is kept), after one warm up run
+#define BANDWIDTH_FLOATS (1 << 26)      // 256MB per buffer, capped by CL_DEVICE_MAX_MEM_ALLOC_SIZE
+#define ROOF_ELEMENTS (1 << 24)         // Floats per operand buffer for the kernel roofline
+#define ROOF_DIM 2048                   // Square GEMM size (multiple of 128 for matrixMul6)
+#define ROOF_MATRIX 4096                // matrixAdd, matrixVectorMul and transpose size
+#define ROOF_IMAGE 4096                 // read_write_image size
+#define SPLITK_DIM 256                  // Split-K shape: SPLITK_DIM x SPLITK_DIM x SPLITK_K
+#define SPLITK_K (1 << 16)
+#define SPLITK_SPLITS 16
+
+// Must match shaders/roofline.cl
+#define LOCAL_SIZE 256
+#define LOCAL_ITERS 1024
+#define FMA_ITERS 1024
+
+// Must match shaders/matrixMul.cl
+#define TS 32
+#define WPT 8
+#define WIDTH 4
+#define TSM 128
+#define TSN 128
+#define TSK 16
+#define WPTM 8
+#define WPTN 8
+#define TRANSPOSEX 16
+#define TRANSPOSEY 16
+
+struct RooflineEntry{
+	std::string name;
+	double flops;
+	double bytes;   //compulsory global memory traffic
+	double seconds; //0: not run on this device
+	std::string note;
+};
+
+//Best of BENCH_REPEAT runs from profiling events, spanning the first command start to the last command end
+double TimeCommands(cl::CommandQueue &queue, std::function<void(std::vector<cl::Event>&)> enqueue){
+	double best = 0;
+	for(int r = 0; r <= BENCH_REPEAT; r++){
+		std::vector<cl::Event> events;
+		enqueue(events);
+		queue.finish();
+		cl_ulong start = events.front().getProfilingInfo<CL_PROFILING_COMMAND_START>();
+		cl_ulong end = events.back().getProfilingInfo<CL_PROFILING_COMMAND_END>();
+		double seconds = (end - start) * 1e-9;
+		if(r > 0 && (best == 0 || seconds < best)) best = seconds;
+	}
+	return best;
+}
+
+double TimeKernel(cl::CommandQueue &queue, cl::Kernel &kernel, cl::NDRange global, cl::NDRange local = cl::NullRange){
+	return TimeCommands(queue, [&](std::vector<cl::Event> &events){
+		events.emplace_back();
+		queue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local, NULL, &events.back());
+	});
+}
+
+bool FitsWorkGroup(cl::Kernel &kernel, cl::Device &device, size_t localItems){
+	return localItems <= kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device);
+}
+
+void PrintBandwidth(std::string label, double bytes, double seconds){
+	std::cout<<"\t"<<std::left<<std::setw(28)<<label<<std::right<<std::setw(10)<<std::fixed<<std::setprecision(1)
+		<<bytes / seconds * 1e-9<<" GB/s"<<std::endl;
+}
+
+int main() {
+	CTimer timer;
+	timer.initialize();
+
+	CCLAPP clApp(false, true, false);//verbose, profiler (profiling queue), verify
+	clApp.initDevice();
+	//Start every build up front; they compile in parallel and each is waited for only when needed
+	clApp.loadShader("roofline.cl");
+	const char *shaders[] = {"matrixMul.cl", "vectorAdd.cl", "matrixAdd.cl", "matrixVectorMul.cl", "imageIO.cl"};
+	for(auto shader : shaders) clApp.requestProgram(shader);
+	CSgemm blas(clApp);
+	blas.request();
+
+	clApp.buildProgram();
+
+	cl::CommandQueue &queue = clApp.queue;
+	cl::Device &device = clApp.device;
+	cl_uint computeUnits = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+
+	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Initializazion done");
+
+	/**************
+	*** Ceilings
+	**************/
+	size_t maxAllocFloats = device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>() / sizeof(float);
+	size_t nFloats = std::min((size_t)BANDWIDTH_FLOATS, maxAllocFloats) & ~(size_t)7; //multiple of the widest vector
+	size_t nBytes = nFloats * sizeof(float);
+
+	std::vector<float> ones(nFloats, 1.0f);
+	cl::Buffer in_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, nBytes, ones.data());
+	cl::Buffer out_device(clApp.context, CL_MEM_READ_WRITE, nBytes);
+
+	std::cout<<"Global memory bandwidth ("<<nBytes / (1 << 20)<<"MB buffers):"<<std::endl;
+	double peakBandwidth = 0;
+	const int widths[] = {1, 2, 4, 8};
+	for(int width : widths){
+		cl_ulong n = nFloats / width;
+		std::string suffix = std::to_string(width);
+
+		cl::Kernel readKernel(clApp.program, ("readBandwidth" + suffix).c_str());
+		readKernel.setArg(0, n);
+		readKernel.setArg(1, in_device);
+		readKernel.setArg(2, out_device);
+		double readSeconds = TimeKernel(queue, readKernel, n);
+
+		cl::Kernel writeKernel(clApp.program, ("writeBandwidth" + suffix).c_str());
+		writeKernel.setArg(0, n);
+		writeKernel.setArg(1, 1.0f);
+		writeKernel.setArg(2, out_device);
+		double writeSeconds = TimeKernel(queue, writeKernel, n);
+
+		cl::Kernel copyKernel(clApp.program, ("copyBandwidth" + suffix).c_str());
+		copyKernel.setArg(0, n);
+		copyKernel.setArg(1, in_device);
+		copyKernel.setArg(2, out_device);
+		double copySeconds = TimeKernel(queue, copyKernel, n);
+
+		std::string type = width == 1 ? "float" : "float" + suffix;
+		PrintBandwidth("read  " + type, nBytes, readSeconds);
+		PrintBandwidth("write " + type, nBytes, writeSeconds);
+		PrintBandwidth("copy  " + type + " (r+w)", 2.0 * nBytes, copySeconds);
+		peakBandwidth = std::max({peakBandwidth, nBytes / readSeconds, nBytes / writeSeconds, 2.0 * nBytes / copySeconds});
+	}
+
+	std::cout<<"Local memory bandwidth:"<<std::endl;
+	cl::Kernel localKernel(clApp.program, "localBandwidth");
+	if(FitsWorkGroup(localKernel, device, LOCAL_SIZE)){
+		size_t localGlobal = (size_t)computeUnits * LOCAL_SIZE * 64;
+		localKernel.setArg(0, in_device);
+		localKernel.setArg(1, out_device);
+		double localSeconds = TimeKernel(queue, localKernel, localGlobal, LOCAL_SIZE);
+		PrintBandwidth("read  float4", (double)localGlobal * LOCAL_ITERS * 4 * sizeof(float), localSeconds);
+	}else std::cout<<"\tskipped: work-group of "<<LOCAL_SIZE<<" not supported"<<std::endl;
+
+	std::cout<<"Host <-> device transfer ("<<nBytes / (1 << 20)<<"MB):"<<std::endl;
+	{
+		std::vector<float> pageable(nFloats, 1.0f);
+		double pageableWrite = TimeCommands(queue, [&](std::vector<cl::Event> &events){
+			events.emplace_back();
+			queue.enqueueWriteBuffer(out_device, CL_FALSE, 0, nBytes, pageable.data(), NULL, &events.back());
+		});
+		double pageableRead = TimeCommands(queue, [&](std::vector<cl::Event> &events){
+			events.emplace_back();
+			queue.enqueueReadBuffer(out_device, CL_FALSE, 0, nBytes, pageable.data(), NULL, &events.back());
+		});
+		PrintBandwidth("pageable host >> device", nBytes, pageableWrite);
+		PrintBandwidth("pageable device >> host", nBytes, pageableRead);
+
+		//Pinned: host pointer of a mapped CL_MEM_ALLOC_HOST_PTR buffer
+		cl::Buffer pinned_buffer(clApp.context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, nBytes);
+		float *pinned = (float*)queue.enqueueMapBuffer(pinned_buffer, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, nBytes);
+		double pinnedWrite = TimeCommands(queue, [&](std::vector<cl::Event> &events){
+			events.emplace_back();
+			queue.enqueueWriteBuffer(out_device, CL_FALSE, 0, nBytes, pinned, NULL, &events.back());
+		});
+		double pinnedRead = TimeCommands(queue, [&](std::vector<cl::Event> &events){
+			events.emplace_back();
+			queue.enqueueReadBuffer(out_device, CL_FALSE, 0, nBytes, pinned, NULL, &events.back());
+		});
+		queue.enqueueUnmapMemObject(pinned_buffer, pinned);
+		queue.finish();
+		PrintBandwidth("pinned host >> device", nBytes, pinnedWrite);
+		PrintBandwidth("pinned device >> host", nBytes, pinnedRead);
+	}
+
+	std::cout<<"Peak FMA throughput:"<<std::endl;
+	cl::Kernel fmaKernel(clApp.program, "fmaThroughput");
+	size_t fmaGlobal = (size_t)computeUnits * 1024 * 16;
+	fmaKernel.setArg(0, 0.999f);
+	fmaKernel.setArg(1, 0.001f);
+	fmaKernel.setArg(2, out_device);
+	double fmaSeconds = TimeKernel(queue, fmaKernel, fmaGlobal);
+	double peakFlops = (double)fmaGlobal * FMA_ITERS * 8 * 4 * 2 / fmaSeconds;
+	std::cout<<"\t"<<std::left<<std::setw(28)<<"fma float4"<<std::right<<std::setw(10)<<peakFlops * 1e-9<<" GFLOP/s"<<std::endl;
+
+	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Ceilings done");
+
+	/**************
+	*** Kernels on the roofline
+	**************/
+	cl::Program matrixMulProgram = clApp.getProgram("matrixMul.cl");
+	cl::Program vectorAddProgram = clApp.getProgram("vectorAdd.cl");
+	cl::Program matrixAddProgram = clApp.getProgram("matrixAdd.cl");
+	cl::Program matrixVectorMulProgram = clApp.getProgram("matrixVectorMul.cl");
+	cl::Program imageIOProgram = clApp.getProgram("imageIO.cl");
+	blas.init();
+
+	std::vector<float> data(ROOF_ELEMENTS);
+	for(size_t i = 0; i < data.size(); i++) data[i] = (float)(i % 1024) / 1024.0f;
+	const size_t roofBytes = data.size() * sizeof(float);
+	cl::Buffer A_device(clApp.context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, roofBytes, data.data());
+	cl::Buffer B_device(clApp.context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, roofBytes, data.data());
+	cl::Buffer C_device(clApp.context, CL_MEM_READ_WRITE, roofBytes);
+	cl::Buffer C_part_device(clApp.context, CL_MEM_READ_WRITE, (size_t)SPLITK_SPLITS * SPLITK_DIM * SPLITK_DIM * sizeof(float));
+
+	std::vector<RooflineEntry> entries;
+
+	{ //vectorAdd
+		cl_ulong n = ROOF_ELEMENTS;
+		cl::Kernel kernel(vectorAddProgram, "vectorAdd");
+		kernel.setArg(0, n);
+		kernel.setArg(1, A_device);
+		kernel.setArg(2, B_device);
+		kernel.setArg(3, C_device);
+		entries.push_back({"vectorAdd", (double)n, 12.0 * n, TimeKernel(queue, kernel, n), ""});
+	}
+	{ //matrixAdd
+		int M = ROOF_MATRIX, N = ROOF_MATRIX;
+		cl::Kernel kernel(matrixAddProgram, "matrixAdd");
+		kernel.setArg(0, M);
+		kernel.setArg(1, N);
+		kernel.setArg(2, A_device);
+		kernel.setArg(3, B_device);
+		kernel.setArg(4, C_device);
+		entries.push_back({"matrixAdd", (double)M * N, 12.0 * M * N, TimeKernel(queue, kernel, cl::NDRange(M, N)), ""});
+	}
+	{ //matrixVectorMul
+		int M = ROOF_MATRIX, N = ROOF_MATRIX;
+		cl::Kernel kernel(matrixVectorMulProgram, "matrixVectorMul");
+		kernel.setArg(0, M);
+		kernel.setArg(1, N);
+		kernel.setArg(2, A_device);
+		kernel.setArg(3, B_device);
+		kernel.setArg(4, C_device);
+		entries.push_back({"matrixVectorMul", 2.0 * M * N, 4.0 * ((double)M * N + M + N),
+			TimeKernel(queue, kernel, cl::NDRange(M)), "one work-item per row"});
+	}
+	{ //transpose
+		int P = ROOF_MATRIX, Q = ROOF_MATRIX;
+		cl::Kernel kernel(matrixMulProgram, "transpose");
+		kernel.setArg(0, P);
+		kernel.setArg(1, Q);
+		kernel.setArg(2, A_device);
+		kernel.setArg(3, C_device);
+		entries.push_back({"transpose", 0, 8.0 * P * Q,
+			TimeKernel(queue, kernel, cl::NDRange(P, Q), cl::NDRange(TRANSPOSEX, TRANSPOSEY)), ""});
+	}
+
+	//matrixMul1..6: launch configurations as in matrixMulOpenCL.cpp, 5 and 6 read B as already transposed
+	const int D = ROOF_DIM;
+	const double gemmFlops = 2.0 * D * D * D;
+	const double gemmBytes = 4.0 * 3 * D * D;
+	cl::NDRange gemmGlobals[6] = {cl::NDRange(D, D), cl::NDRange(D, D), cl::NDRange(D, D/WPT),
+		cl::NDRange(D/WIDTH, D), cl::NDRange(D, D/WPT), cl::NDRange(D/WPTM, D/WPTN)};
+	cl::NDRange gemmLocals[6] = {cl::NullRange, cl::NDRange(TS, TS), cl::NDRange(TS, TS/WPT),
+		cl::NDRange(TS/WIDTH, TS), cl::NDRange(TS, TS/WPT), cl::NDRange(TSM/WPTM, TSN/WPTN)};
+	size_t gemmLocalItems[6] = {1, TS*TS, TS*TS/WPT, TS*TS/WIDTH, TS*TS/WPT, (TSM/WPTM)*(TSN/WPTN)};
+	for(int i = 0; i < 6; i++){
+		std::string name = "matrixMul" + std::to_string(i+1);
+		cl::Kernel kernel(matrixMulProgram, name.c_str());
+		if(!FitsWorkGroup(kernel, device, gemmLocalItems[i])){
+			entries.push_back({name, gemmFlops, gemmBytes, 0, "work-group of " + std::to_string(gemmLocalItems[i]) + " not supported"});
+			continue;
+		}
+		kernel.setArg(0, D);
+		kernel.setArg(1, D);
+		kernel.setArg(2, D);
+		kernel.setArg(3, A_device);
+		kernel.setArg(4, B_device);
+		kernel.setArg(5, C_device);
+		entries.push_back({name, gemmFlops, gemmBytes, TimeKernel(queue, kernel, gemmGlobals[i], gemmLocals[i]), ""});
+	}
+
+	{ //matrixMul6SplitK + splitKReduce on a tall-skinny shape
+		int M = SPLITK_DIM, N = SPLITK_DIM, K = SPLITK_K, splits = SPLITK_SPLITS;
+		int tilesPerSplit = (K/TSK + splits - 1) / splits;
+		cl::Kernel kernel(matrixMulProgram, "matrixMul6SplitK");
+		kernel.setArg(0, M);
+		kernel.setArg(1, N);
+		kernel.setArg(2, K);
+		kernel.setArg(3, tilesPerSplit);
+		kernel.setArg(4, A_device);
+		kernel.setArg(5, B_device);
+		kernel.setArg(6, C_part_device);
+		cl::Kernel reduce(matrixMulProgram, "splitKReduce");
+		reduce.setArg(0, M*N);
+		reduce.setArg(1, splits);
+		reduce.setArg(2, C_part_device);
+		reduce.setArg(3, C_device);
+		double seconds = TimeCommands(queue, [&](std::vector<cl::Event> &events){
+			events.emplace_back();
+			queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(M/WPTM, N/WPTN, splits),
+				cl::NDRange(TSM/WPTM, TSN/WPTN, 1), NULL, &events.back());
+			events.emplace_back();
+			queue.enqueueNDRangeKernel(reduce, cl::NullRange, M*N, 256, NULL, &events.back());
+		});
+		entries.push_back({"matrixMul6SplitK+reduce", 2.0 * M * N * K, 4.0 * ((double)M * K + (double)K * N + M * N), seconds,
+			std::to_string(M) + "x" + std::to_string(N) + "x" + std::to_string(K) + ", " + std::to_string(splits) + " splits"});
+	}
+
+	{ //sgemm variants
+		const SgemmTranspose trans[2] = {SgemmNoTrans, SgemmTrans};
+		const char *names[2][2] = {{"sgemmNN", "sgemmNT"}, {"sgemmTN", "sgemmTT"}};
+		for(int ta = 0; ta < 2; ta++)
+			for(int tb = 0; tb < 2; tb++){
+				double seconds = TimeCommands(queue, [&](std::vector<cl::Event> &events){
+					events.emplace_back();
+					blas.sgemm(trans[ta], trans[tb], D, D, D, 1.0f, A_device, 0, D, B_device, 0, D, 0.0f, C_device, 0, D, &events.back());
+				});
+				entries.push_back({names[ta][tb], gemmFlops, gemmBytes, seconds, ""});
+			}
+	}
+
+	{ //read_write_image
+		int W = ROOF_IMAGE, H = ROOF_IMAGE;
+		if(device.getInfo<CL_DEVICE_IMAGE_SUPPORT>() && device.getInfo<CL_DEVICE_IMAGE2D_MAX_WIDTH>() >= (size_t)W){
+			cl::ImageFormat grayscale(CL_R, CL_FLOAT);
+			cl::Image2D Input_Image(clApp.context, CL_MEM_READ_ONLY, grayscale, W, H);
+			cl::Image2D Output_Image(clApp.context, CL_MEM_WRITE_ONLY, grayscale, W, H);
+			cl::Kernel kernel(imageIOProgram, "read_write_image");
+			kernel.setArg(0, Input_Image);
+			kernel.setArg(1, Output_Image);
+			entries.push_back({"read_write_image", 0, 8.0 * W * H, TimeKernel(queue, kernel, cl::NDRange(W, H)), ""});
+		}else entries.push_back({"read_write_image", 0, 8.0 * W * H, 0, "images not supported"});
+	}
+
+	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Kernels done");
+
+	//Attainable time is the larger of the compute and memory bounds; % of bound = attainable / measured
+	std::cout<<std::endl<<"Roofline: peak "<<std::setprecision(1)<<peakFlops * 1e-9<<" GFLOP/s, "
+		<<peakBandwidth * 1e-9<<" GB/s, ridge point "<<std::setprecision(2)<<peakFlops / peakBandwidth<<" FLOP/byte"<<std::endl;
+	std::cout<<std::left<<std::setw(26)<<"Kernel"<<std::right<<std::setw(10)<<"FLOP/B"<<std::setw(12)<<"GFLOP/s"
+		<<std::setw(10)<<"GB/s"<<std::setw(14)<<"Bound GFLOP/s"<<std::setw(8)<<"Bound"<<std::setw(10)<<"% bound"<<"  Note"<<std::endl;
+	for(auto &entry : entries){
+		std::cout<<std::left<<std::setw(26)<<entry.name<<std::right<<std::fixed;
+		double intensity = entry.flops / entry.bytes;
+		std::cout<<std::setw(10)<<std::setprecision(2)<<intensity;
+		if(entry.seconds <= 0){
+			std::cout<<std::setw(54)<<"-"<<"  "<<entry.note<<std::endl;
+			continue;
+		}
+		double boundSeconds = std::max(entry.flops / peakFlops, entry.bytes / peakBandwidth);
+		bool memoryBound = entry.bytes / peakBandwidth >= entry.flops / peakFlops;
+		std::cout<<std::setprecision(1)
+			<<std::setw(12)<<entry.flops / entry.seconds * 1e-9
+			<<std::setw(10)<<entry.bytes / entry.seconds * 1e-9
+			<<std::setw(14)<<std::min(peakFlops, intensity * peakBandwidth) * 1e-9
+			<<std::setw(8)<<(memoryBound ? "mem" : "FLOP")
+			<<std::setw(10)<<boundSeconds / entry.seconds * 100.0
+			<<"  "<<entry.note<<std::endl;
+	}
+
+	return 1;
+}
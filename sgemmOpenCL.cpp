@@ -0,0 +1,149 @@
+#include "clFramework/sgemm.hpp"
+#include <iomanip>
+
+//Packed problem for timing
+#define DIM 2048
+
+//Sub-matrix views: odd sizes inside a larger parent matrix
+#define PARENT 1024
+#define VIEWM 300
+#define VIEWN 200
+#define VIEWK 500
+
+//Reference: C = alpha * op(A) * op(B) + beta * C, indexing each layout directly (no operand swap)
+void CPUSgemm(SgemmLayout layout, SgemmTranspose transA, SgemmTranspose transB, int M, int N, int K,
+	float alpha, std::vector<float> &A, int offA, int lda, std::vector<float> &B, int offB, int ldb,
+	float beta, std::vector<float> &C, int offC, int ldc){
+	auto at = [layout](std::vector<float> &X, int off, int ld, int row, int col) -> float& {
+		return layout == SgemmColMajor ? X[off + col*ld + row] : X[off + row*ld + col];
+	};
+	for(int n = 0; n < N; n++){
+		for(int m = 0; m < M; m++){
+			float acc = 0.0f;
+			for(int k = 0; k < K; k++){
+				float a = transA ? at(A, offA, lda, k, m) : at(A, offA, lda, m, k);
+				float b = transB ? at(B, offB, ldb, n, k) : at(B, offB, ldb, k, n);
+				acc += a * b;
+			}
+			float &c = at(C, offC, ldc, m, n);
+			c = alpha * acc + (beta != 0.0f ? beta * c : 0.0f);
+		}
+	}
+}
+
+int Verify(std::string message, std::vector<float> &expected, std::vector<float> &actual, float threshold){
+	int count = 0;
+	for (size_t i=0; i<expected.size(); i++) {
+		float diff = std::abs(expected[i]-actual[i]);
+		if(diff > threshold){
+			if(count <= 5)
+				std::cout<<"i="<<i<<std::setprecision(10) <<", Host: "<<expected[i]<<", Device: "<<actual[i]<<", Diff: "<<diff<<std::endl;
+			count++;
+		}
+	}
+	if(count > 5) std::cout<<"("<<count-5<<" failed numbers not printed.)"<<std::endl;
+	std::cout<<"Verification "<<message<<": "<<count<<"/"<<expected.size()<<" number(s) failed"<<std::endl;
+	return count;
+}
+
+int main() {
+	CTimer timer;
+	timer.initialize();
+
+	srand(time(NULL));
+
+	CCLAPP clApp(false, true, true);//verbose, profiler, verify
+	clApp.initDevice();
+
+	CSgemm blas(clApp);
+	blas.request(); //builds in the background while host data is generated and uploaded
+
+	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Initializazion done");
+
+	//Part 1: every layout and transpose combination on views of one parent matrix per operand.
+	//Views start at an offset and use the parent's leading dimension, nothing is repacked.
+	std::vector<float> a_host(PARENT*PARENT);
+	std::vector<float> b_host(PARENT*PARENT);
+	std::vector<float> c_init(PARENT*PARENT);
+	{
+		CTraceScope traceScope(clApp.tracer, "Generate data");
+		for (int i=0; i<PARENT*PARENT; i++) {
+			a_host[i] = (float)rand() / (float)RAND_MAX;
+			b_host[i] = (float)rand() / (float)RAND_MAX;
+			c_init[i] = (float)rand() / (float)RAND_MAX;
+		}
+	}
+
+	cl::Buffer A_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+		a_host.size() * sizeof(float), a_host.data());
+	cl::Buffer B_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+		b_host.size() * sizeof(float), b_host.data());
+	cl::Buffer C_device(clApp.context, CL_MEM_READ_WRITE,
+		c_init.size() * sizeof(float));
+
+	if(!blas.init()) return 0; //blocks until the build is done
+	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Build program done");
+
+	const int ld = PARENT;
+	const int offA = 3*ld + 5;
+	const int offB = 7*ld + 11;
+	const int offC = 13*ld + 17;
+	const float alpha = 1.5f;
+	const float beta = 0.5f;
+	int failed = 0;
+
+	for(int l = 0; l < 2; l++){
+		for(int ta = 0; ta < 2; ta++){
+			for(int tb = 0; tb < 2; tb++){
+				SgemmLayout layout = (SgemmLayout)l;
+				SgemmTranspose transA = (SgemmTranspose)ta;
+				SgemmTranspose transB = (SgemmTranspose)tb;
+
+				clApp.queue.enqueueWriteBuffer(C_device, CL_TRUE, 0, c_init.size() * sizeof(float), c_init.data());
+				blas.sgemm(layout, transA, transB, VIEWM, VIEWN, VIEWK,
+					alpha, A_device, offA, ld, B_device, offB, ld, beta, C_device, offC, ld,
+					clApp.tracer.newEvent("sgemm view"));
+
+				std::vector<float> c_host(c_init.size());
+				clApp.queue.enqueueReadBuffer(C_device, CL_TRUE, 0, c_host.size() * sizeof(float), c_host.data());
+
+				if(clApp.bVerify){
+					CTraceScope traceScope(clApp.tracer, "Verify");
+					std::vector<float> c_expected = c_init;
+					CPUSgemm(layout, transA, transB, VIEWM, VIEWN, VIEWK,
+						alpha, a_host, offA, ld, b_host, offB, ld, beta, c_expected, offC, ld);
+					std::string message = std::string(layout == SgemmColMajor ? "col-major " : "row-major ")
+						+ (transA ? "T" : "N") + (transB ? "T" : "N");
+					failed += Verify(message, c_expected, c_host, 0.001f);
+				}
+			}
+		}
+	}
+	if(clApp.bVerify) std::cout<<"Sub-matrix views: "<<(failed ? "FAILED" : "passed")<<std::endl;
+
+	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Sub-matrix views done");
+
+	//Part 2: packed column-major DIM x DIM x DIM for timing
+	std::vector<float> x_host((size_t)DIM*DIM);
+	for (size_t i=0; i<x_host.size(); i++)
+		x_host[i] = (float)rand() / (float)RAND_MAX;
+	cl::Buffer X_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+		x_host.size() * sizeof(float), x_host.data());
+	cl::Buffer Y_device(clApp.context, CL_MEM_READ_WRITE,
+		x_host.size() * sizeof(float));
+
+	blas.sgemm(SgemmNoTrans, SgemmNoTrans, DIM, DIM, DIM, 1.0f, X_device, 0, DIM, X_device, 0, DIM, 0.0f, Y_device, 0, DIM); //warm up
+	clApp.queue.finish();
+	if(clApp.bProfiler) timer.printDeltaTime("---Profiler: Warm up done");
+
+	auto start = std::chrono::high_resolution_clock::now();
+	blas.sgemm(SgemmNoTrans, SgemmNoTrans, DIM, DIM, DIM, 1.0f, X_device, 0, DIM, X_device, 0, DIM, 0.0f, Y_device, 0, DIM,
+		clApp.tracer.newEvent("sgemmNN"));
+	clApp.queue.finish();
+	auto end = std::chrono::high_resolution_clock::now();
+	double seconds = std::chrono::duration<double>(end - start).count();
+	std::cout<<"sgemm "<<DIM<<"x"<<DIM<<"x"<<DIM<<": "<<seconds<<"s, "
+		<<2.0*DIM*DIM*DIM / seconds * 1e-9<<" GFLOP/s"<<std::endl;
+
+	return 1;
+}
@@ -0,0 +1,198 @@
+// 2D convolution as an implicit GEMM, per group g:
+// out(OCg by pixels) = weights(OCg by Kg) * im2col(input)(Kg by pixels)
+// with OCg = OC/groups, Kg = (C/groups)*R*S and pixels = N*OH*OW.
+// The im2col matrix is never stored: the B tile loads compute input addresses on the fly
+// (zero outside the padded input). Tiling is the 2D register blocking of matrixMul6.
+//
+// Layouts (LAYOUT_NHWC build option):
+//   0: input/output NCHW, weights OIHW, k = (c, r, s)
+//   1: input/output NHWC, weights OHWI, k = (r, s, c)
+// In both cases a weight row is contiguous in k, and k runs along the contiguous input
+// dimension for NHWC (channels) while pixels do for NCHW (width).
+
+#ifndef LAYOUT_NHWC
+#define LAYOUT_NHWC 0
+#endif
+
+// Tile sizes are passed by the host at build time (see clFramework/conv2d.hpp)
+#ifndef TSM
+#define TSM 64                       // The tile-size in dimension M (output channels)
+#endif
+#ifndef TSN
+#define TSN 128                      // The tile-size in dimension N (output pixels)
+#endif
+#ifndef TSK
+#define TSK 16                       // The tile-size in dimension K (filter taps)
+#endif
+#ifndef WPTM
+#define WPTM 4                       // The amount of work-per-thread in dimension M
+#endif
+#ifndef WPTN
+#define WPTN 8                       // The amount of work-per-thread in dimension N
+#endif
+#define RTSM (TSM/WPTM)              // The reduced tile-size in dimension M (== number of threads)
+#define RTSN (TSN/WPTN)              // The reduced tile-size in dimension N (== number of threads)
+#define LPTA ((TSK*TSM)/(RTSM*RTSN)) // The amount of loads-per-thread for A
+#define LPTB ((TSK*TSN)/(RTSM*RTSN)) // The amount of loads-per-thread for B
+#define PAD 1                        // Local memory padding, avoids bank conflicts on transposed stores
+
+#define CEIL_DIV(x,y) (((x) + (y) - 1) / (y))
+
+#define CONV_ARGS const int N, const int C, const int H, const int W, \
+                  const int OC, const int R, const int S, const int OH, const int OW, \
+                  const int strideH, const int strideW, const int padH, const int padW, \
+                  const int dilationH, const int dilationW, const int groups
+
+// Input value for filter tap k of output pixel p in group g, 0 in the padding
+float loadInput(global const float *input, const int k, const int p, const int g, CONV_ARGS){
+    const int Cg = C/groups;
+#if LAYOUT_NHWC
+    const int c = k % Cg;
+    const int r = k / (Cg*S);
+    const int s = (k / Cg) % S;
+#else
+    const int c = k / (R*S);
+    const int r = (k / S) % R;
+    const int s = k % S;
+#endif
+    const int n = p / (OH*OW);
+    const int oh = (p / OW) % OH;
+    const int ow = p % OW;
+    const int ih = oh*strideH - padH + r*dilationH;
+    const int iw = ow*strideW - padW + s*dilationW;
+    if (ih < 0 || ih >= H || iw < 0 || iw >= W) return 0.0f;
+#if LAYOUT_NHWC
+    return input[(((size_t)n*H + ih)*W + iw)*C + g*Cg + c];
+#else
+    return input[(((size_t)n*C + g*Cg + c)*H + ih)*W + iw];
+#endif
+}
+
+kernel void conv2dImplicitGemm(CONV_ARGS, global const float *input, global const float *weights, global float *output){
+    // Thread identifiers
+    const int tidm = get_local_id(0); // Local row ID (max: RTSM)
+    const int tidn = get_local_id(1); // Local col ID (max: RTSN)
+    const int offsetM = TSM*get_group_id(0); // Work-group offset
+    const int offsetN = TSN*get_group_id(1); // Work-group offset
+    const int g = get_group_id(2); // Convolution group
+    const int tid = tidn*RTSM + tidm;
+
+    // GEMM dimensions of this group
+    const int OCg = OC/groups;
+    const int Kg = (C/groups)*R*S;
+    const int P = N*OH*OW;
+    global const float *A = weights + (size_t)g*OCg*Kg;
+
+    // Local memory to fit a tile of A and B
+    __local float Asub[TSK][TSM+PAD];
+    __local float Bsub[TSK][TSN+PAD];
+
+    // Allocate register space
+    float Areg;
+    float Breg[WPTN];
+    float acc[WPTM][WPTN];
+
+    // Initialise the accumulation registers
+    #pragma unroll
+    for (int wm=0; wm<WPTM; wm++) {
+        #pragma unroll
+        for (int wn=0; wn<WPTN; wn++) {
+            acc[wm][wn] = 0.0f;
+        }
+    }
+
+    // Loop over all tiles, the last one may be partial
+    const int numTiles = CEIL_DIV(Kg,TSK);
+    for (int t=0; t<numTiles; t++) {
+
+        // Load one tile of the weights (TSK by TSM), rows are contiguous in k
+        #pragma unroll
+        for (int la=0; la<LPTA; la++) {
+            int id = la*RTSN*RTSM + tid;
+            int k = id%TSK;
+            int m = id/TSK;
+            int globalM = offsetM + m;
+            int globalK = TSK*t + k;
+            Asub[k][m] = (globalM < OCg && globalK < Kg) ? A[(size_t)globalM*Kg + globalK] : 0.0f;
+        }
+
+        // Gather one tile of the implicit im2col matrix (TSK by TSN)
+        #pragma unroll
+        for (int lb=0; lb<LPTB; lb++) {
+            int id = lb*RTSN*RTSM + tid;
+#if LAYOUT_NHWC
+            int k = id%TSK;
+            int n = id/TSK;
+#else
+            int n = id%TSN;
+            int k = id/TSN;
+#endif
+            int globalN = offsetN + n;
+            int globalK = TSK*t + k;
+            float value = 0.0f;
+            if (globalN < P && globalK < Kg)
+                value = loadInput(input, globalK, globalN, g, N, C, H, W, OC, R, S, OH, OW,
+                                  strideH, strideW, padH, padW, dilationH, dilationW, groups);
+            Bsub[k][n] = value;
+        }
+
+        // Synchronise to make sure the tile is loaded
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        // Loop over the values of a single tile
+        for (int k=0; k<TSK; k++) {
+
+            // Cache the values of Bsub in registers
+            #pragma unroll
+            for (int wn=0; wn<WPTN; wn++) {
+                Breg[wn] = Bsub[k][tidn + wn*RTSN];
+            }
+
+            // Perform the computation
+            #pragma unroll
+            for (int wm=0; wm<WPTM; wm++) {
+                Areg = Asub[k][tidm + wm*RTSM];
+                #pragma unroll
+                for (int wn=0; wn<WPTN; wn++) {
+                    acc[wm][wn] += Areg * Breg[wn];
+                }
+            }
+        }
+
+        // Synchronise before loading the next tile
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    // Store the final results in the output tensor
+    #pragma unroll
+    for (int wm=0; wm<WPTM; wm++) {
+        int globalRow = offsetM + tidm + wm*RTSM;
+        #pragma unroll
+        for (int wn=0; wn<WPTN; wn++) {
+            int globalCol = offsetN + tidn + wn*RTSN;
+            if (globalRow < OCg && globalCol < P) {
+                int oc = g*OCg + globalRow;
+                int n = globalCol / (OH*OW);
+                int pixel = globalCol % (OH*OW);
+#if LAYOUT_NHWC
+                output[((size_t)n*OH*OW + pixel)*OC + oc] = acc[wm][wn];
+#else
+                output[((size_t)n*OC + oc)*OH*OW + pixel] = acc[wm][wn];
+#endif
+            }
+        }
+    }
+}
+
+// Explicit im2col, for comparison: col[g] is column-major Kg by (N*OH*OW), one column per output pixel
+kernel void im2col(CONV_ARGS, global const float *input, global float *col){
+    const int k = get_global_id(0);
+    const int p = get_global_id(1);
+    const int g = get_global_id(2);
+    const int Kg = (C/groups)*R*S;
+    const int P = N*OH*OW;
+    if (k < Kg && p < P) {
+        col[((size_t)g*P + p)*Kg + k] = loadInput(input, k, p, g, N, C, H, W, OC, R, S, OH, OW,
+                                                  strideH, strideW, padH, padW, dilationH, dilationW, groups);
+    }
+}
@@ -5,4 +5,12 @@ kernel void matrixAdd(const int M, const int N, global const float *A, global co
 
     size_t i = globalCol*M + globalRow;
     C[i] = A[i] + B[i];
-}
\ No newline at end of file
+}
+
+// Grid-stride variant over the flattened M*N elements (A, B and C share one layout),
+// used by the streaming engine (clFramework/stream.hpp)
+kernel void matrixAddStride(const ulong n, global const float *A, global const float *B, global float *C){
+    for (size_t i = get_global_id(0); i < n; i += get_global_size(0)) {
+        C[i] = A[i] + B[i];
+    }
+}
@@ -421,3 +421,104 @@ kernel void matrixMul6(const int M, const int N, const int K, global const float
 }
 
 
+
+
+// Split-K version of kernel 6: work-group z computes the partial product over its own
+// range of K tiles and stores it in the workspace slice Cpart[z*M*N ...]
+kernel void matrixMul6SplitK(const int M, const int N, const int K, const int tilesPerSplit, global const float *A, global const float *B, global float *Cpart ){
+    // Thread identifiers
+    const int tidm = get_local_id(0); // Local row ID (max: TSM/WPTM == RTSM)
+    const int tidn = get_local_id(1); // Local col ID (max: TSN/WPTN == RTSN)
+    const int offsetM = TSM*get_group_id(0); // Work-group offset
+    const int offsetN = TSN*get_group_id(1); // Work-group offset
+    const int split = get_group_id(2); // Slice of K handled by this work-group
+
+    // Local memory to fit a tile of A and B
+    __local float Asub[TSK][TSM];
+    __local float Bsub[TSN][TSK+2];
+
+    // Allocate register space
+    float Areg;
+    float Breg[WPTN];
+    float acc[WPTM][WPTN];
+
+    // Initialise the accumulation registers
+    #pragma unroll
+    for (int wm=0; wm<WPTM; wm++) {
+        #pragma unroll
+        for (int wn=0; wn<WPTN; wn++) {
+            acc[wm][wn] = 0.0f;
+        }
+    }
+
+    // Loop over the tiles of this split only
+    const int numTiles = K/TSK;
+    const int firstTile = split*tilesPerSplit;
+    const int lastTile = MIN(firstTile + tilesPerSplit, numTiles);
+    for (int t=firstTile; t<lastTile; t++) {
+
+        // Load one tile of A and B into local memory
+        #pragma unroll
+        for (int la=0; la<LPTA; la++) {
+            int tid = tidn*RTSM + tidm;
+            int id = la*RTSN*RTSM + tid;
+            int row = MOD2(id,TSM);
+            int col = DIV2(id,TSM);
+            int tiledIndex = TSK*t + col;
+            Asub[col][row] = A[tiledIndex*M + offsetM + row];
+            Bsub[row][col] = B[tiledIndex*N + offsetN + row];
+        }
+
+        // Synchronise to make sure the tile is loaded
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        // Loop over the values of a single tile
+        for (int k=0; k<TSK; k++) {
+
+            // Cache the values of Bsub in registers
+            #pragma unroll
+            for (int wn=0; wn<WPTN; wn++) {
+                int col = tidn + wn*RTSN;
+                Breg[wn] = Bsub[col][k];
+            }
+
+            // Perform the computation
+            #pragma unroll
+            for (int wm=0; wm<WPTM; wm++) {
+                int row = tidm + wm*RTSM;
+                Areg = Asub[k][row];
+                #pragma unroll
+                for (int wn=0; wn<WPTN; wn++) {
+                    acc[wm][wn] += Areg * Breg[wn];
+                }
+            }
+        }
+
+        // Synchronise before loading the next tile
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    // Store the partial results in this split's slice of the workspace
+    global float *Cslice = Cpart + (size_t)split*M*N;
+    #pragma unroll
+    for (int wm=0; wm<WPTM; wm++) {
+        int globalRow = offsetM + tidm + wm*RTSM;
+        #pragma unroll
+        for (int wn=0; wn<WPTN; wn++) {
+            int globalCol = offsetN + tidn + wn*RTSN;
+            Cslice[globalCol*M + globalRow] = acc[wm][wn];
+        }
+    }
+}
+
+// Second pass of split-K: sum the partial C slices (fixed order, so the result is deterministic)
+kernel void splitKReduce(const int MN, const int splits, global const float *Cpart, global float *C ){
+    const int i = get_global_id(0);
+    if (i < MN) {
+        float acc = 0.0f;
+        for (int s=0; s<splits; s++) {
+            acc += Cpart[(size_t)s*MN + i];
+        }
+        C[i] = acc;
+    }
+}
@@ -0,0 +1,61 @@
+// Microbenchmarks for the roofline ceilings: global memory bandwidth (read, write, copy) per
+// vector width, local memory bandwidth and peak FMA throughput.
+// Results are only written when an impossible condition holds, so the compiler can't drop the work.
+
+#define LOCAL_SIZE 256                  // Work-group size of localBandwidth
+#define LOCAL_ITERS 1024                // Local memory reads per work-item
+#define FMA_ITERS 1024                  // FMA iterations per work-item (8 float4 chains each)
+
+#define SUM1(x) (x)
+#define SUM2(x) ((x).s0 + (x).s1)
+#define SUM4(x) ((x).s0 + (x).s1 + (x).s2 + (x).s3)
+#define SUM8(x) ((x).s0 + (x).s1 + (x).s2 + (x).s3 + (x).s4 + (x).s5 + (x).s6 + (x).s7)
+
+// n is the number of floatX elements, inputs are non-negative
+#define BANDWIDTH_KERNELS(W, floatX, SUM) \
+kernel void readBandwidth##W(const ulong n, global const floatX *in, global float *out){ \
+    floatX acc = (floatX)(0.0f); \
+    for (size_t i = get_global_id(0); i < n; i += get_global_size(0)) \
+        acc += in[i]; \
+    if (SUM(acc) < 0.0f) out[0] = SUM(acc); \
+} \
+kernel void writeBandwidth##W(const ulong n, const float value, global floatX *out){ \
+    for (size_t i = get_global_id(0); i < n; i += get_global_size(0)) \
+        out[i] = (floatX)(value); \
+} \
+kernel void copyBandwidth##W(const ulong n, global const floatX *in, global floatX *out){ \
+    for (size_t i = get_global_id(0); i < n; i += get_global_size(0)) \
+        out[i] = in[i]; \
+}
+
+BANDWIDTH_KERNELS(1, float, SUM1)
+BANDWIDTH_KERNELS(2, float2, SUM2)
+BANDWIDTH_KERNELS(4, float4, SUM4)
+BANDWIDTH_KERNELS(8, float8, SUM8)
+
+// Every work-item reads LOCAL_ITERS float4 from local memory, consecutive work-items hit consecutive banks
+kernel void localBandwidth(global const float4 *in, global float *out){
+    __local float4 buffer[LOCAL_SIZE];
+    const int lid = get_local_id(0);
+    buffer[lid] = in[get_global_id(0) % LOCAL_SIZE];
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    float4 acc = (float4)(0.0f);
+    for (int r=0; r<LOCAL_ITERS; r++) {
+        acc += buffer[(lid + r) & (LOCAL_SIZE - 1)];
+    }
+    if (SUM4(acc) < 0.0f) out[0] = SUM4(acc);
+}
+
+// 8 independent float4 FMA chains per work-item hide the FMA latency
+kernel void fmaThroughput(const float a, const float b, global float *out){
+    float4 x0 = (float4)(get_global_id(0) * 1e-9f), x1 = x0 + 1.0f, x2 = x0 + 2.0f, x3 = x0 + 3.0f;
+    float4 x4 = x0 + 4.0f, x5 = x0 + 5.0f, x6 = x0 + 6.0f, x7 = x0 + 7.0f;
+    const float4 va = (float4)(a), vb = (float4)(b);
+    for (int i=0; i<FMA_ITERS; i++) {
+        x0 = fma(x0, va, vb); x1 = fma(x1, va, vb); x2 = fma(x2, va, vb); x3 = fma(x3, va, vb);
+        x4 = fma(x4, va, vb); x5 = fma(x5, va, vb); x6 = fma(x6, va, vb); x7 = fma(x7, va, vb);
+    }
+    float4 acc = x0 + x1 + x2 + x3 + x4 + x5 + x6 + x7;
+    if (SUM4(acc) < -1e30f) out[0] = SUM4(acc);
+}
@@ -0,0 +1,151 @@
+// BLAS-style single precision GEMM, column-major:
+// C(M by N) = alpha * op(A)(M by K) * op(B)(K by N) + beta * C
+// with op(X) = X or X^T, element offsets and leading dimensions, so sub-matrix views
+// and row-major data (handled by the host as the transposed problem) need no repacking.
+// Tiling follows matrixMul6 (2D register blocking) with bounds checks for arbitrary sizes.
+
+// Tile sizes are passed by the host at build time (see clFramework/sgemm.hpp)
+#ifndef TSM
+#define TSM 64                       // The tile-size in dimension M
+#endif
+#ifndef TSN
+#define TSN 64                       // The tile-size in dimension N
+#endif
+#ifndef TSK
+#define TSK 16                       // The tile-size in dimension K
+#endif
+#ifndef WPTM
+#define WPTM 4                       // The amount of work-per-thread in dimension M
+#endif
+#ifndef WPTN
+#define WPTN 4                       // The amount of work-per-thread in dimension N
+#endif
+#define RTSM (TSM/WPTM)              // The reduced tile-size in dimension M (== number of threads)
+#define RTSN (TSN/WPTN)              // The reduced tile-size in dimension N (== number of threads)
+#define LPTA ((TSK*TSM)/(RTSM*RTSN)) // The amount of loads-per-thread for A
+#define LPTB ((TSK*TSN)/(RTSM*RTSN)) // The amount of loads-per-thread for B
+#define PAD 1                        // Local memory padding, avoids bank conflicts on transposed stores
+
+#define CEIL_DIV(x,y) (((x) + (y) - 1) / (y))
+
+// Shared body of the four variants. transA/transB are compile-time constants at every call site,
+// so each kernel gets its own load pattern: threads are laid out along the contiguous dimension
+// of the operand in memory, which keeps the global loads coalesced for every combination.
+void sgemmTile(const int transA, const int transB,
+                const int M, const int N, const int K, const float alpha, const float beta,
+                global const float *A, const int lda,
+                global const float *B, const int ldb,
+                global float *C, const int ldc,
+                local float (*Asub)[TSM+PAD], local float (*Bsub)[TSN+PAD]){
+    // Thread identifiers
+    const int tidm = get_local_id(0); // Local row ID (max: RTSM)
+    const int tidn = get_local_id(1); // Local col ID (max: RTSN)
+    const int offsetM = TSM*get_group_id(0); // Work-group offset
+    const int offsetN = TSN*get_group_id(1); // Work-group offset
+    const int tid = tidn*RTSM + tidm;
+
+    // Allocate register space
+    float Areg;
+    float Breg[WPTN];
+    float acc[WPTM][WPTN];
+
+    // Initialise the accumulation registers
+    #pragma unroll
+    for (int wm=0; wm<WPTM; wm++) {
+        #pragma unroll
+        for (int wn=0; wn<WPTN; wn++) {
+            acc[wm][wn] = 0.0f;
+        }
+    }
+
+    // Loop over all tiles, the last one may be partial
+    const int numTiles = CEIL_DIV(K,TSK);
+    for (int t=0; t<numTiles; t++) {
+
+        // Load one tile of op(A) (TSK by TSM) into local memory
+        #pragma unroll
+        for (int la=0; la<LPTA; la++) {
+            int id = la*RTSN*RTSM + tid;
+            int m = transA ? id/TSK : id%TSM;
+            int k = transA ? id%TSK : id/TSM;
+            int globalM = offsetM + m;
+            int globalK = TSK*t + k;
+            float value = 0.0f;
+            if (globalM < M && globalK < K)
+                value = transA ? A[(size_t)globalM*lda + globalK] : A[(size_t)globalK*lda + globalM];
+            Asub[k][m] = value;
+        }
+
+        // Load one tile of op(B) (TSK by TSN) into local memory
+        #pragma unroll
+        for (int lb=0; lb<LPTB; lb++) {
+            int id = lb*RTSN*RTSM + tid;
+            int n = transB ? id%TSN : id/TSK;
+            int k = transB ? id/TSN : id%TSK;
+            int globalN = offsetN + n;
+            int globalK = TSK*t + k;
+            float value = 0.0f;
+            if (globalN < N && globalK < K)
+                value = transB ? B[(size_t)globalK*ldb + globalN] : B[(size_t)globalN*ldb + globalK];
+            Bsub[k][n] = value;
+        }
+
+        // Synchronise to make sure the tile is loaded
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        // Loop over the values of a single tile
+        for (int k=0; k<TSK; k++) {
+
+            // Cache the values of Bsub in registers
+            #pragma unroll
+            for (int wn=0; wn<WPTN; wn++) {
+                Breg[wn] = Bsub[k][tidn + wn*RTSN];
+            }
+
+            // Perform the computation
+            #pragma unroll
+            for (int wm=0; wm<WPTM; wm++) {
+                Areg = Asub[k][tidm + wm*RTSM];
+                #pragma unroll
+                for (int wn=0; wn<WPTN; wn++) {
+                    acc[wm][wn] += Areg * Breg[wn];
+                }
+            }
+        }
+
+        // Synchronise before loading the next tile
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    // Store the final results in C, C is not read when beta == 0 (BLAS semantics)
+    #pragma unroll
+    for (int wm=0; wm<WPTM; wm++) {
+        int globalRow = offsetM + tidm + wm*RTSM;
+        #pragma unroll
+        for (int wn=0; wn<WPTN; wn++) {
+            int globalCol = offsetN + tidn + wn*RTSN;
+            if (globalRow < M && globalCol < N) {
+                size_t index = (size_t)globalCol*ldc + globalRow;
+                float result = alpha * acc[wm][wn];
+                if (beta != 0.0f) result += beta * C[index];
+                C[index] = result;
+            }
+        }
+    }
+}
+
+// One kernel per transpose combination: sgemmNN, sgemmNT, sgemmTN, sgemmTT
+#define SGEMM_KERNEL(NAME, TRANSA, TRANSB) \
+kernel void NAME(const int M, const int N, const int K, const float alpha, const float beta, \
+                 global const float *A, const int offA, const int lda, \
+                 global const float *B, const int offB, const int ldb, \
+                 global float *C, const int offC, const int ldc){ \
+    __local float Asub[TSK][TSM+PAD]; \
+    __local float Bsub[TSK][TSN+PAD]; \
+    sgemmTile(TRANSA, TRANSB, M, N, K, alpha, beta, A + offA, lda, B + offB, ldb, C + offC, ldc, Asub, Bsub); \
+}
+
+SGEMM_KERNEL(sgemmNN, 0, 0)
+SGEMM_KERNEL(sgemmNT, 0, 1)
+SGEMM_KERNEL(sgemmTN, 1, 0)
+SGEMM_KERNEL(sgemmTT, 1, 1)
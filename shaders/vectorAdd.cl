@@ -25,4 +25,17 @@ kernel void vectorAdd(
     if (i < n) {
         c[i] = a[i] + b[i];
     }
-}
\ No newline at end of file
+}
+
+// Grid-stride variant: any global size covers any n, used by the streaming engine (clFramework/stream.hpp)
+kernel void vectorAddStride(
+        ulong n,
+        global const float *a,
+        global const float *b,
+        global float *c
+        )
+{
+    for (size_t i = get_global_id(0); i < n; i += get_global_size(0)) {
+        c[i] = a[i] + b[i];
+    }
+}
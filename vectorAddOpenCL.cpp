@@ -1,23 +1,25 @@
 #include "clFramework/clApp.hpp"
+#include "clFramework/stream.hpp"
+#include <chrono>
+
+#define VECTOR_SIZE (1 << 20)               // Resident mode: one buffer per vector, one launch
+#define STREAM_SIZE ((size_t)1 << 27)       // Streaming mode: bounded by host memory only, the engine stages chunks
 
 int main() {
 	CCLAPP clApp(true, true, true);
 	clApp.initDevice();
-	clApp.loadShader("vectorAdd.cl");// Compute c = a + b.
-	clApp.buildProgram();
+	clApp.loadShader("vectorAdd.cl");// Compute c = a + b. Builds in the background while host data is set up
 
 	
     //try {
 
-	//Step 1: Create kernel program from shader function
-	cl::Kernel program_kernel(clApp.program, "vectorAdd");
-
-	//Step 2: Allocate host buffers
-	std::vector<float> a_host(clApp.maxNDRange, 1); //double
-	std::vector<float> b_host(clApp.maxNDRange, 2); //double
-	std::vector<float> c_host(clApp.maxNDRange); //double
+	//Step 1: Allocate host buffers
+	const size_t vectorSize = std::min((size_t)VECTOR_SIZE, clApp.maxNDRange);
+	std::vector<float> a_host(vectorSize, 1); //double
+	std::vector<float> b_host(vectorSize, 2); //double
+	std::vector<float> c_host(vectorSize); //double
 
-	//Step 3: host >> device (Allocate device buffers and transfer data) 
+	//Step 2: host >> device (Allocate device buffers and transfer data) 
 	cl::Buffer A_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
 		a_host.size() * sizeof(float), a_host.data());
 	cl::Buffer B_device(clApp.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
@@ -25,21 +27,55 @@ int main() {
 	cl::Buffer C_device(clApp.context, CL_MEM_READ_WRITE,
 		c_host.size() * sizeof(float));
 
+	//Step 3: Create kernel program from shader function (blocks until the build is done)
+	clApp.buildProgram();
+	cl::Kernel program_kernel(clApp.program, "vectorAdd");
+
 	//Step 4: Set kernel parameters.
-	program_kernel.setArg(0, static_cast<cl_ulong>(clApp.maxNDRange));
+	program_kernel.setArg(0, static_cast<cl_ulong>(vectorSize));
 	program_kernel.setArg(1, A_device);
 	program_kernel.setArg(2, B_device);
 	program_kernel.setArg(3, C_device);
 	
 	//Step 5: Launch kernel on the compute device.
-	clApp.queue.enqueueNDRangeKernel(program_kernel, cl::NullRange, clApp.maxNDRange, cl::NullRange);
+	clApp.queue.enqueueNDRangeKernel(program_kernel, cl::NullRange, vectorSize, cl::NullRange, NULL, clApp.tracer.newEvent("vectorAdd"));
 	clApp.queue.finish();//block host until device finishes
 
 	//Step 6: device >> host
-	clApp.queue.enqueueReadBuffer(C_device, CL_TRUE, 0, c_host.size() * sizeof(float), c_host.data());
+	clApp.queue.enqueueReadBuffer(C_device, CL_TRUE, 0, c_host.size() * sizeof(float), c_host.data(), NULL, clApp.tracer.newEvent("Read C"));
 
 	// Should get '3' here.
-	std::cout << "Result is: " << c_host[134224] << std::endl;
+	std::cout << "Result is: " << c_host[vectorSize / 2] << std::endl;
+
+	//Streaming mode: STREAM_SIZE elements in chunks, upload/compute/download overlapped on three queues
+	{
+		CStreamEngine stream(clApp, 2, 1);
+		cl::Kernel stream_kernel(clApp.program, "vectorAddStride");
+
+		std::vector<float> a_stream(STREAM_SIZE), b_stream(STREAM_SIZE), c_stream(STREAM_SIZE);
+		{
+			CTraceScope traceScope(clApp.tracer, "Generate data");
+			for(size_t i = 0; i < STREAM_SIZE; i++){
+				a_stream[i] = (float)(i % 1024);
+				b_stream[i] = 2;
+			}
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		stream.run(stream_kernel, STREAM_SIZE, {a_stream.data(), b_stream.data()}, {c_stream.data()});
+		auto end = std::chrono::high_resolution_clock::now();
+		double seconds = std::chrono::duration<double>(end - start).count();
+		std::cout<<"Stream: "<<STREAM_SIZE<<" floats in chunks of "<<stream.getChunkElements()<<", "
+			<<seconds * 1000<<" ms, "<<3.0 * STREAM_SIZE * sizeof(float) / seconds * 1e-9<<" GB/s host<>device"<<std::endl;
+
+		if(clApp.bVerify){
+			CTraceScope traceScope(clApp.tracer, "Verify");
+			size_t count = 0;
+			for(size_t i = 0; i < STREAM_SIZE; i++)
+				if(c_stream[i] != a_stream[i] + b_stream[i]) count++;
+			std::cout<<"Verification done: "<<count<<"/"<<STREAM_SIZE<<" number(s) failed"<<std::endl;
+		}
+	}
 
     //} catch (const cl::Error &err) {
 	//	std::cerr